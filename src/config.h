@@ -9,5 +9,14 @@ struct config
     bool fillTriangles = true; // f key
     bool showStatsWindow = false; // F1 key
     bool autoRotate = false; // r key
+    bool binnedRendering = false; // t key
+    bool sortLastRendering = false; // c key, not together with binnedRendering
+    bool unorderedRendering = false; // u key, not together with binned or sort-last rendering
+    int fillMode = 1; // v key, minity::fillMode (scalar, simd, scanline)
+    bool visibilityBuffer = false; // b key
+    bool tiledFramebuffer = false; // m key
+    int depthFormat = 0; // z key, minity::depthFormat (float, reversed-Z float, 24 and 16 bit unorm)
+    bool depthPrepass = false; // o key, depth only pass before shading (not with the visibility buffer)
+    unsigned int rasterizerThreads = 0; // for binned, sort-last and unordered rendering, 0 = all hardware threads
 };
 config *g_config = new config();
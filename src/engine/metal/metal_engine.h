@@ -156,7 +156,7 @@ void metalEngine::run(scene scene)
         position = sf3(scene.model.position);
         scale = sf3(scene.model.scale);
         rotation = sf3(scene.model.rotation);
-        metalRenderer.renderModel(position, scale, rotation, color);
+        metalRenderer.renderModel(position, scale, rotation, color, scene.model.culling, scene.model.frontFace);
 
         ft->delta(); // update delta time and ignore fps for now
         deltaTime = ft->deltaTime();
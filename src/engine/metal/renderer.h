@@ -126,7 +126,8 @@ public:
     Renderer(CA::MetalLayer *layer, minity::mesh &mesh, minity::image& texture);
     ~Renderer();
     // one render pass
-    void renderModel(const simd::float3 &position, const simd::float3 &scale, const simd::float3 &angle, const simd::float4 &color);
+    void renderModel(const simd::float3 &position, const simd::float3 &scale, const simd::float3 &angle, const simd::float4 &color,
+                     minity::cullMode culling = minity::kCullBack, minity::winding frontFace = minity::kClockwise);
 private:
     void initPipeline();
     void initDepthTexture();
@@ -341,7 +342,8 @@ void Renderer::initBuffers(minity::mesh &mesh)
     queue = device->newCommandQueue();
 };
 
-void Renderer::renderModel(const simd::float3 &position, const simd::float3 &scale, const simd::float3 &rotation, const simd::float4 &color)
+void Renderer::renderModel(const simd::float3 &position, const simd::float3 &scale, const simd::float3 &rotation, const simd::float4 &color,
+                           minity::cullMode culling, minity::winding frontFace)
 {
     auto drawable = layer->nextDrawable();
     using simd::float3;
@@ -446,8 +448,11 @@ void Renderer::renderModel(const simd::float3 &position, const simd::float3 &sca
 
     encoder->setFragmentTexture( pTexture, /* index */ 0 );
 
-    encoder->setCullMode( MTL::CullModeBack ); // none/front/back
-    encoder->setFrontFacingWinding( MTL::Winding::WindingClockwise ); // (counter)clockwise WindingCounterClockwise
+    // the cull mode and winding of the model, as in the software renderer
+    encoder->setCullMode( culling == minity::kCullNone ? MTL::CullModeNone
+                        : culling == minity::kCullFront ? MTL::CullModeFront : MTL::CullModeBack );
+    encoder->setFrontFacingWinding( frontFace == minity::kClockwise
+                                  ? MTL::Winding::WindingClockwise : MTL::Winding::WindingCounterClockwise );
     // encoder->setDepthClipMode( MTL::DepthClipMode::DepthClipModeClip ); // clip/clamp
     auto fillMode = MTL::TriangleFillMode::TriangleFillModeFill;
     if (g_config->drawWireframe)
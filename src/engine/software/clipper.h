@@ -0,0 +1,266 @@
+#pragma once
+
+#include <array>
+#include <cmath>
+#include <utility>
+#include <vector>
+
+#include "../../simpleMath.h"
+#include "../../mesh.h"
+
+namespace minity
+{
+
+// a vertex of a face to clip, everything in it is linear in clip space
+// and interpolated along the clipped edges
+struct clipVertex
+{
+    vec3 clip; // clip space position
+    vec3 view; // view space position
+    vec3 normal; // view space normal
+    vec2 texcoord;
+};
+
+typedef std::array<clipVertex, 3> clippedFace;
+
+enum clipResult
+{
+    kClipRejected, // outside the view volume, nothing to draw
+    kClipInside, // inside the view volume, drawn as is
+    kClipGuardBand, // crosses only the screen sides (within the guard band), drawn as is
+    kClipClipped // crosses the near or far plane (or the guard band), the clipped faces are added
+};
+
+// the planes of the view volume, inside where dot(plane, clip position) >= 0
+enum clipPlane
+{
+    kClipMinZ, // z >= minZ * w: near plane, or far plane with reversed-Z
+    kClipMaxZ, // z <= w: far plane, or near plane with reversed-Z
+    kClipLeft, // x >= -w
+    kClipRight, // x <= w
+    kClipBottom, // y >= -w
+    kClipTop, // y <= w
+    kClipPlanes
+};
+
+// the planes with the screen sides at x, y = +-band (in NDC units)
+inline std::array<vec3, kClipPlanes> clipPlanes(float minZ, float band)
+{
+    return {{
+        {0.0f, 0.0f, 1.0f, -minZ},
+        {0.0f, 0.0f, -1.0f, 1.0f},
+        {1.0f, 0.0f, 0.0f, band},
+        {-1.0f, 0.0f, 0.0f, band},
+        {0.0f, 1.0f, 0.0f, band},
+        {0.0f, -1.0f, 0.0f, band}}};
+}
+
+inline float clipDistance(const vec3 &plane, const vec3 &clip)
+{
+    return plane.x * clip.x + plane.y * clip.y + plane.z * clip.z + plane.w * clip.w;
+}
+
+inline vec3 lerpClip(const vec3 &from, const vec3 &to, float t)
+{
+    return {from.x + (to.x - from.x) * t,
+            from.y + (to.y - from.y) * t,
+            from.z + (to.z - from.z) * t,
+            from.w + (to.w - from.w) * t};
+}
+
+inline clipVertex lerpClip(const clipVertex &from, const clipVertex &to, float t)
+{
+    return {lerpClip(from.clip, to.clip, t),
+            lerpClip(from.view, to.view, t),
+            lerpClip(from.normal, to.normal, t),
+            {from.texcoord.u + (to.texcoord.u - from.texcoord.u) * t,
+             from.texcoord.v + (to.texcoord.v - from.texcoord.v) * t}};
+}
+
+/**
+ * @brief clip a face in homogeneous clip space
+ *
+ * Clipping before the perspective divide also handles the vertices behind
+ * the camera (w <= 0), which have no meaningful NDC or screen position.
+ * Each vertex gets an outcode of the planes it is outside of: a face
+ * outside one plane with all three vertices is rejected, and a face that
+ * crosses only the screen sides but stays within the guard band is drawn
+ * as is, the rasterizer limits the bounding box to the viewport anyway.
+ * Only faces crossing the near or far plane (or the guard band) go through
+ * the Sutherland-Hodgman clipper, against just the planes they cross.
+ * The clipped polygon is split into a fan of faces with the winding of the
+ * original face.
+ *
+ * An intersection is always interpolated from the inside vertex of the
+ * edge, so two faces sharing the edge get exactly the same new vertex.
+ *
+ * @param face the vertices with clip space positions
+ * @param minZ z of the NDC minZ plane: -1, or 0 with reversed-Z
+ * @param guardBand the guard band x, y in NDC units (the screen is 1),
+ *        screen coordinates within it must be exact in the rasterizer
+ * @param out the clipped faces are added to this
+ * @return what to draw, see clipResult
+ *
+ * @see https://en.wikipedia.org/wiki/Sutherland%E2%80%93Hodgman_algorithm
+ * @see https://fgiesen.wordpress.com/2011/07/05/a-trip-through-the-graphics-pipeline-2011-part-5/
+ */
+clipResult clipFace(const clippedFace &face, float minZ, float guardBand, std::vector<clippedFace> &out)
+{
+    const auto screenPlanes = clipPlanes(minZ, 1.0f);
+    const auto guardBandPlanes = clipPlanes(minZ, guardBand);
+    auto outcode = [](const std::array<vec3, kClipPlanes> &planes, const vec3 &clip) {
+        unsigned int code{0};
+        for (int plane = 0; plane < kClipPlanes; ++plane)
+            code |= (clipDistance(planes[plane], clip) < 0.0f ? 1u : 0u) << plane;
+        return code;
+    };
+
+    unsigned int screenCodes[3];
+    unsigned int guardBandCodes[3];
+    for (int i : {0, 1, 2})
+    {
+        screenCodes[i] = outcode(screenPlanes, face[i].clip);
+        guardBandCodes[i] = outcode(guardBandPlanes, face[i].clip);
+    }
+    if (screenCodes[0] & screenCodes[1] & screenCodes[2])
+        return kClipRejected;
+    const unsigned int crossed = guardBandCodes[0] | guardBandCodes[1] | guardBandCodes[2];
+    if (crossed == 0)
+        return (screenCodes[0] | screenCodes[1] | screenCodes[2]) ? kClipGuardBand : kClipInside;
+
+    // every plane adds at most one vertex
+    clipVertex polygons[2][3 + kClipPlanes];
+    clipVertex *polygon = polygons[0];
+    clipVertex *clipped = polygons[1];
+    int count{3};
+    for (int i : {0, 1, 2})
+        polygon[i] = face[i];
+
+    for (int plane = 0; plane < kClipPlanes; ++plane)
+    {
+        if (!(crossed & (1u << plane)))
+            continue;
+
+        int clippedCount{0};
+        for (int i = 0; i < count; ++i)
+        {
+            const clipVertex &from = polygon[i];
+            const clipVertex &to = polygon[(i + 1) % count];
+            const float fromDistance = clipDistance(guardBandPlanes[plane], from.clip);
+            const float toDistance = clipDistance(guardBandPlanes[plane], to.clip);
+            if (fromDistance >= 0.0f)
+                clipped[clippedCount++] = from;
+            if ((fromDistance >= 0.0f) != (toDistance >= 0.0f))
+            {
+                clipped[clippedCount++] = fromDistance >= 0.0f
+                    ? lerpClip(from, to, fromDistance / (fromDistance - toDistance))
+                    : lerpClip(to, from, toDistance / (toDistance - fromDistance));
+            }
+        }
+        std::swap(polygon, clipped);
+        count = clippedCount;
+        if (count < 3)
+            return kClipRejected;
+    }
+
+    for (int i = 1; i + 1 < count; ++i)
+        out.push_back({polygon[0], polygon[i], polygon[i + 1]});
+    return kClipClipped;
+}
+
+/**
+ * @brief test the bounding volumes of a mesh against the view volume
+ *
+ * The clip space planes are moved to model space with the model-view-
+ * projection matrix instead of transforming the bounds: a point p is
+ * inside a plane if dot(plane, m * p) = dot(transpose(m) * plane, p) >= 0
+ * (the plane extraction of Gribb and Hartmann). The plane normals are not
+ * normalized, the radius of the sphere is scaled by their length instead.
+ * The box is only tested against the planes crossing the sphere, with its
+ * corner furthest inside (outside test) and furthest outside (inside test).
+ *
+ * @param bounds the bounds of the mesh in model space
+ * @param m the model-view-projection matrix
+ * @param minZ z of the NDC minZ plane: -1, or 0 with reversed-Z
+ * @param guardBand the guard band x, y in NDC units, see clipFace
+ * @return kClipRejected if the mesh is outside the view volume,
+ *         kClipInside or kClipGuardBand if none of its faces need clipping
+ *         and kClipClipped if some faces may need clipping
+ *
+ * @see https://www.gamedevs.org/uploads/fast-extraction-viewing-frustum-planes-from-world-view-projection-matrix.pdf
+ */
+clipResult clipBounds(const meshBounds &bounds, const mat4 &m, float minZ, float guardBand)
+{
+    // returns false if outside one of the planes, inside is true if inside all of them
+    auto test = [&](float band, bool &inside) {
+        inside = true;
+        for (const vec3 &volumePlane : clipPlanes(minZ, band))
+        {
+            vec3 plane;
+            plane.x = volumePlane.x * m.m[0][0] + volumePlane.y * m.m[1][0] + volumePlane.z * m.m[2][0] + volumePlane.w * m.m[3][0];
+            plane.y = volumePlane.x * m.m[0][1] + volumePlane.y * m.m[1][1] + volumePlane.z * m.m[2][1] + volumePlane.w * m.m[3][1];
+            plane.z = volumePlane.x * m.m[0][2] + volumePlane.y * m.m[1][2] + volumePlane.z * m.m[2][2] + volumePlane.w * m.m[3][2];
+            plane.w = volumePlane.x * m.m[0][3] + volumePlane.y * m.m[1][3] + volumePlane.z * m.m[2][3] + volumePlane.w * m.m[3][3];
+
+            const float radius = bounds.radius * std::sqrt(plane.x * plane.x + plane.y * plane.y + plane.z * plane.z);
+            const float distance = clipDistance(plane, bounds.center);
+            if (distance < -radius)
+                return false;
+            if (distance >= radius)
+                continue;
+
+            const vec3 furthestInside{plane.x >= 0.0f ? bounds.max.x : bounds.min.x,
+                                      plane.y >= 0.0f ? bounds.max.y : bounds.min.y,
+                                      plane.z >= 0.0f ? bounds.max.z : bounds.min.z};
+            const vec3 furthestOutside{plane.x >= 0.0f ? bounds.min.x : bounds.max.x,
+                                       plane.y >= 0.0f ? bounds.min.y : bounds.max.y,
+                                       plane.z >= 0.0f ? bounds.min.z : bounds.max.z};
+            if (clipDistance(plane, furthestInside) < 0.0f)
+                return false;
+            if (clipDistance(plane, furthestOutside) < 0.0f)
+                inside = false;
+        }
+        return true;
+    };
+
+    bool inside;
+    if (!test(1.0f, inside))
+        return kClipRejected;
+    if (inside)
+        return kClipInside;
+    test(guardBand, inside);
+    return inside ? kClipGuardBand : kClipClipped;
+}
+
+/**
+ * @brief face culling with the signed area of the screen space vertices
+ *
+ * Screen y grows down, so a face that looks clockwise on the screen has
+ * a positive area. Only the sign matters: a 2D cross product and no
+ * normalization, compared to the face normal and camera ray in view space.
+ * The screen positions must be in front of the camera (clip space w > 0),
+ * faces crossing the near plane are culled after clipping.
+ * Faces with no area are culled unless the cull mode is none.
+ *
+ * SEE: https://en.wikipedia.org/wiki/Back-face_culling
+ *
+ * @param screen the screen space vertices
+ * @param culling which faces to cull, see model.culling
+ * @param frontFace winding order of the front faces, see model.frontFace
+ * @return true if the face should not be drawn
+ */
+inline bool isCulled(const vec3 (&screen)[3], cullMode culling, winding frontFace)
+{
+    if (culling == kCullNone)
+        return false;
+
+    const float area = (screen[1].x - screen[0].x) * (screen[2].y - screen[0].y)
+                     - (screen[2].x - screen[0].x) * (screen[1].y - screen[0].y);
+    const bool clockwise = area > 0.0f;
+    const bool counterClockwise = area < 0.0f;
+    const bool front = frontFace == kClockwise ? clockwise : counterClockwise;
+    const bool back = frontFace == kClockwise ? counterClockwise : clockwise;
+    return culling == kCullBack ? !front : !back;
+}
+
+} // NS minity
@@ -0,0 +1,146 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "simd.h"
+
+namespace minity
+{
+
+// storage formats of the depth buffer
+enum depthFormat
+{
+    kDepthFloat, // z in [-1, 1] as float, nearer is smaller (default)
+    kDepthReversedFloat, // reversed-Z: z in [0, 1] as float, nearer is larger,
+                         // see perspectiveProjectionMatrix(..., reversedZ)
+    kDepthUnorm24, // z in [-1, 1] as 24 bit unsigned normalized integer
+    kDepthUnorm16 // z in [-1, 1] as 16 bit unsigned normalized integer
+};
+
+typedef u_int16_t shortv __attribute__((vector_size(kSimdLanes * sizeof(u_int16_t))));
+
+// the bits of a float as an unsigned int in the order of the floats:
+// the sign bit is flipped for positive and all bits for negative values
+inline u_int32_t orderedFloat(float value)
+{
+    u_int32_t bits;
+    std::memcpy(&bits, &value, sizeof(bits));
+    return bits & 0x80000000u ? ~bits : bits | 0x80000000u;
+}
+inline float fromOrderedFloat(u_int32_t ordered)
+{
+    const u_int32_t bits = ordered & 0x80000000u ? ordered & 0x7fffffffu : ~ordered;
+    float value;
+    std::memcpy(&value, &bits, sizeof(value));
+    return value;
+}
+
+/**
+ * @brief how a depth format stores and compares z
+ *
+ * encode converts the interpolated z to the stored value and passes is the
+ * depth test of an encoded z against the stored value (scalar and per lane).
+ * key maps z to a float that is smaller for nearer z in every format, the
+ * hierarchical z keeps the farthest key of a block and farthestKey is an
+ * upper bound of the keys of all z passing against a stored value.
+ * ordered maps a stored value to an unsigned int that is smaller for
+ * nearer values (unordered mode, see rasterizer::setUnordered).
+ */
+template <depthFormat Format>
+struct depthTraits;
+
+template <>
+struct depthTraits<kDepthFloat>
+{
+    typedef float type;
+    static constexpr type clear = std::numeric_limits<float>::infinity();
+
+    static type encode(float z) { return z; }
+    static float decode(type stored) { return stored; }
+    static bool passes(type z, type stored) { return z <= stored; }
+    static float key(float z) { return z; }
+    static float farthestKey(type stored) { return stored; }
+    static u_int32_t ordered(type stored) { return orderedFloat(stored); }
+    static type fromOrdered(u_int32_t ordered) { return fromOrderedFloat(ordered); }
+
+    static floatv encode(floatv z) { return z; }
+    static intv passes(floatv z, floatv stored) { return z <= stored; }
+    static floatv load(const type *depth, int lanes) { return loadLanes<floatv>(depth, lanes); }
+    static void store(type *depth, floatv values, int lanes) { storeLanes(depth, values, lanes); }
+};
+
+template <>
+struct depthTraits<kDepthReversedFloat>
+{
+    typedef float type;
+    static constexpr type clear = -std::numeric_limits<float>::infinity();
+
+    static type encode(float z) { return z; }
+    static float decode(type stored) { return stored; }
+    static bool passes(type z, type stored) { return z >= stored; }
+    static float key(float z) { return -z; }
+    static float farthestKey(type stored) { return -stored; }
+    static u_int32_t ordered(type stored) { return ~orderedFloat(stored); }
+    static type fromOrdered(u_int32_t ordered) { return fromOrderedFloat(~ordered); }
+
+    static floatv encode(floatv z) { return z; }
+    static intv passes(floatv z, floatv stored) { return z >= stored; }
+    static floatv load(const type *depth, int lanes) { return loadLanes<floatv>(depth, lanes); }
+    static void store(type *depth, floatv values, int lanes) { storeLanes(depth, values, lanes); }
+};
+
+// [-1, 1] -> [0, kMax], rounded half up the same way for scalars and lanes
+template <typename T, int Bits>
+struct unormDepthTraits
+{
+    typedef T type;
+    static constexpr int kMax{(1 << Bits) - 1};
+    static constexpr type clear = kMax;
+
+    static type encode(float z)
+    {
+        const float depth = std::min(std::max((z + 1.0f) * 0.5f, 0.0f), 1.0f);
+        return static_cast<type>(static_cast<int32_t>(depth * kMax + 0.5f));
+    }
+    static float decode(type stored) { return stored * (2.0f / kMax) - 1.0f; }
+    static bool passes(type z, type stored) { return z <= stored; }
+    static float key(float z) { return z; }
+    // everything rounded to stored is nearer than half a step above it
+    static float farthestKey(type stored) { return (stored + 1.0f) * (2.0f / kMax) - 1.0f; }
+    static u_int32_t ordered(type stored) { return stored; }
+    static type fromOrdered(u_int32_t ordered) { return static_cast<type>(ordered); }
+
+    static intv encode(floatv z)
+    {
+        floatv depth = (z + 1.0f) * 0.5f;
+        depth = select(depth < splat(0.0f), splat(0.0f), depth);
+        depth = select(depth > splat(1.0f), splat(1.0f), depth);
+        return __builtin_convertvector(depth * splat(kMax) + 0.5f, intv);
+    }
+    static intv passes(intv z, intv stored) { return z <= stored; }
+    static intv load(const type *depth, int lanes)
+    {
+        if constexpr (sizeof(type) == sizeof(u_int16_t))
+            return __builtin_convertvector(loadLanes<shortv>(depth, lanes), intv);
+        else
+            return loadLanes<intv>(depth, lanes);
+    }
+    static void store(type *depth, intv values, int lanes)
+    {
+        if constexpr (sizeof(type) == sizeof(u_int16_t))
+            storeLanes(depth, __builtin_convertvector(values, shortv), lanes);
+        else
+            storeLanes(depth, values, lanes);
+    }
+};
+
+template <>
+struct depthTraits<kDepthUnorm24> : unormDepthTraits<u_int32_t, 24> {};
+
+template <>
+struct depthTraits<kDepthUnorm16> : unormDepthTraits<u_int16_t, 16> {};
+
+} // NS minity
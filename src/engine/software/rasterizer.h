@@ -1,92 +1,940 @@
 #pragma once
 
+#include <array>
+#include <atomic>
 #include <cmath>
+#include <cstring>
 #include <limits>
 #include <functional>
+#include <memory>
+#include <type_traits>
 
 #define MINITY_SCENE_TYPES_ONLY
 #include "../../simpleMath.h"
 #include "../../color.h"
+#include "depthFormat.h"
+#include "simd.h"
 #include "stats.h"
+#include "threadPool.h"
+#include "varyings.h"
 
 namespace minity
 {
 
 const bool debugRasterizer{false};
 
+// fragment shaders are called with the barycentric coordinates u, v, w and the
+// triangle color and return the pixel color. The rasterizer is templated on the
+// shader type, so lambdas and functors inline into the fill loops
+// (a lambdaShader works too, but every pixel is then an indirect call)
 typedef std::function< minity::color(float&, float&, float&, minity::color) > lambdaShader;
 auto nullShader = [](float &u, float &v, float &w, minity::color color) -> minity::color { (void)u; (void)v; (void)w; return color; };
 
+// binned mode splits the screen into kTileSize x kTileSize tiles
+const int kTileSize{64};
+
+// plotTriangle classifies kBlockSize x kBlockSize pixel blocks
+// before testing the single pixels
+const int kBlockSize{8};
+
+// how plotTriangle walks the covered pixels
+enum fillMode
+{
+    kScalar = 0,  // one pixel at a time (portable reference)
+    kSimd = 1,    // kSimdLanes pixels at a time with lane masks
+    kScanline = 2 // spans of the rows without blocks, incremental interpolation
+};
+
+// empty pixel in the visibility buffer
+const u_int32_t kNoTriangle{0xffffffff};
+
+// when the depth test of triangle fragments runs
+enum depthTest
+{
+    kEarlyDepthTest = 0, // before the fragment shader, occluded fragments are not shaded
+    kLateDepthTest = 1,  // after the fragment shader (e.g. shaders that need to see every fragment),
+                         // in every fill mode: occluded blocks are not skipped either
+    kDepthOnly = 2,      // depth prepass: only the depth is written, no shader and no color
+    kEqualDepth = 3      // after a depth prepass: only the fragments at the stored depth are
+                         // shaded (the nearest one of every pixel), the depth is not written
+};
+
+// screen area (inclusive pixel bounds) that a rasterizer job may write to,
+// in binned mode every tile is owned by one worker thread at a time
+struct tile
+{
+    int minX{0};
+    int minY{0};
+    int maxX{0};
+    int maxY{0};
+};
+
+// unordered mode: a pixel is one word of the ordered depth (see
+// depthTraits) in the high and the color in the low half, so the nearest
+// fragment is the smallest word
+inline u_int64_t packPixel(u_int32_t depth, u_int32_t color) { return static_cast<u_int64_t>(depth) << 32 | color; }
+const u_int64_t kPackedDepth{0xffffffff00000000};
+
 class rasterizer
 {
 public:
-    void drawTriangle(const vec3 (&vertices)[3], const color rgba_color, lambdaShader fragmentShader=nullShader);
+    void drawTriangle(const vec3 (&vertices)[3], const color rgba_color);
+    template <typename Shader>
+    void drawTriangle(const vec3 (&vertices)[3], const color rgba_color, Shader fragmentShader, depthTest depthTest=kEarlyDepthTest);
     void drawLine(const vec3 &from, const vec3 &to, const color rgba_color);
+    // the segments [from, to] of lines[0..count) in one color (e.g. the wireframe)
+    void drawLines(const std::array<vec3, 2> *lines, size_t count, const color rgba_color);
     void drawPoint(const vec3 &point, const color rgba_color);
 
     rasterizer(unsigned int width, unsigned int height)
         : viewportWidth(width), viewportHeight(height)
     {
-        // both are addressed [x + y*viewportWidth]
-        frameBuffer = std::vector<color>(viewportWidth * viewportHeight, minity::black);
-        depthBuffer = std::vector<float>(viewportWidth * viewportHeight, std::numeric_limits<float>::infinity());
+        // both are addressed [pixelIndex(x, y)]
+        blocksX = (viewportWidth + kBlockSize - 1) / kBlockSize;
+        blocksY = (viewportHeight + kBlockSize - 1) / kBlockSize;
+        frameBuffer = std::vector<color>(bufferSize(), minity::black);
+        depthBuffer = std::vector<float>(bufferSize(), std::numeric_limits<float>::infinity());
+        blockDepth = std::vector<float>(blocksX * blocksY, std::numeric_limits<float>::infinity());
+        blockGeneration = std::vector<unsigned long int>(blocksX * blocksY, clearGeneration);
+    };
+
+    // sort-middle mode: triangles are binned to screen tiles and rasterized
+    // by a pool of threads (0 = all hardware threads) when the frame is finished
+    void setBinning(bool binning, unsigned int threads=0);
+    bool isBinning() { return binning; };
+    // sort-last mode: every thread draws a contiguous range of the triangles
+    // (in submission order) to its own frame and depth buffers when the frame
+    // is finished, the buffers are then composited by their depth. Binning
+    // and sort-last exclude each other.
+    void setSortLast(bool sortLast, unsigned int threads=0);
+    bool isSortLast() { return sortLast; };
+    // unordered mode: the triangles are drawn by a pool of threads in any
+    // order when the frame is finished, on top of the buffers packed into
+    // one 64 bit word per pixel (see packPixel). Depth test and color write
+    // are one lock-free atomic min of the word, so there is no binning. A
+    // tie of equal depth goes to the smaller color instead of the later
+    // triangle (opaque geometry), and the shading pass of a depth prepass
+    // has to wait for finishFrame of the depth pass. The words are unpacked
+    // to the buffers afterwards. Excludes binning and sort-last.
+    void setUnordered(bool unordered, unsigned int threads=0);
+    bool isUnordered() { return unordered; };
+    std::atomic<u_int64_t> &packedAt(int x, int y) { return packedBuffer[pixelIndex(x, y)]; };
+    void finishFrame();
+
+    void setFillMode(fillMode mode)
+    {
+        finishFrame();
+        m_fillMode = mode;
+        for (auto &slice : slices)
+            slice->setFillMode(mode);
+    };
+    fillMode getFillMode() { return m_fillMode; };
+
+    // changing the depth format clears the depth buffer, getDepthbuffer
+    // returns z (decoded from the unorm formats) in every format
+    void setDepthFormat(depthFormat format);
+    depthFormat getDepthFormat() { return m_depthFormat; };
+
+    // visibility buffer (deferred) mode: drawTriangle writes the triangle
+    // color as an id to the visibility buffer instead of the frame buffer
+    // and shadeVisibilityBuffer shades every visible pixel once
+    void setVisibilityBuffer(bool enabled);
+    bool isVisibilityBuffer() { return visibility; };
+    template <typename Shade>
+    void shadeVisibilityBuffer(Shade shade);
+    u_int32_t *getVisibilityBuffer();
+
+    // tiled layout: the buffers store kBlockSize x kBlockSize blocks of
+    // pixels contiguously (row-major inside the block and over the blocks),
+    // so a triangle touches fewer cache lines than with rows of the whole
+    // viewport. The getters then resolve to a linear copy of the image.
+    void setTiledLayout(bool enabled);
+    bool isTiledLayout() { return tiled; };
+    size_t pixelIndex(int x, int y) const
+    {
+        if (!tiled)
+            return x + y * viewportWidth;
+        const unsigned int ux = x, uy = y;
+        return (ux / kBlockSize + (uy / kBlockSize) * blocksX) * kBlockSize * kBlockSize
+            + (uy % kBlockSize) * kBlockSize + ux % kBlockSize;
     };
 
+    // linear images [x + y*viewportWidth], valid until the next call
     color *getFramebuffer();
     float *getDepthbuffer();
     unsigned int getViewportWidth();
     unsigned int getViewportHeight();
     void clearBuffers();
 
+    // depth test and write of a single pixel inside the viewport
+    void writePixel(int x, int y, float z, color rgba_color, rasterizerStats &pixelStats);
+    template <depthFormat Format>
+    void writePixel(int x, int y, float z, color rgba_color, rasterizerStats &pixelStats)
+    {
+        touchBlock(x, y);
+        if (testDepth<Format>(x, y, z))
+        {
+            frameBuffer[pixelIndex(x, y)] = rgba_color;
+            if (visibility)
+                visibilityBuffer[pixelIndex(x, y)] = kNoTriangle; // keep the point over the triangle
+            statsPolicy<kRasterizerStats>::pixel(pixelStats.points);
+            if (debugRasterizer)
+                std::cout << "drawn" << std::endl;
+        }
+        else
+        {
+            statsPolicy<kRasterizerStats>::pixel(pixelStats.depth);
+            if (debugRasterizer)
+                std::cout << "z-clipped" << std::endl;
+        }
+    }
+    // depth test of a single pixel, writes the depth if it passes
+    // (the caller writes the color, e.g. after running the shader)
+    bool testDepth(int x, int y, float z);
+    template <depthFormat Format>
+    bool testDepth(int x, int y, float z)
+    {
+        typedef depthTraits<Format> traits;
+        typename traits::type &stored = *depthBufferAt<Format>(x, y);
+        const typename traits::type encoded = traits::encode(z);
+        if (!traits::passes(encoded, stored))
+            return false;
+        stored = encoded;
+        return true;
+    }
+    // the fragment is the one the depth prepass kept (z is not written)
+    template <depthFormat Format>
+    bool equalDepth(int x, int y, float z)
+    {
+        return depthTraits<Format>::encode(z) == *depthBufferAt<Format>(x, y);
+    }
+
+    // raw buffer access for the fill routines (does not finish the frame),
+    // triangles write to the visibility buffer in visibility buffer mode.
+    // Pixels are only contiguous up to the end of their block row.
+    color *colorTargetAt(int x, int y) { return visibility ? &visibilityBuffer[pixelIndex(x, y)] : &frameBuffer[pixelIndex(x, y)]; };
+    template <depthFormat Format>
+    typename depthTraits<Format>::type *depthBufferAt(int x, int y)
+    {
+        if constexpr (Format == kDepthUnorm16)
+            return &depthBuffer16[pixelIndex(x, y)];
+        else if constexpr (Format == kDepthUnorm24)
+            return &depthBuffer24[pixelIndex(x, y)];
+        else
+            return &depthBuffer[pixelIndex(x, y)];
+    }
+
+    // hierarchical z: the farthest depth key (see depthTraits) of the
+    // kBlockSize x kBlockSize block containing pixel x, y - fragments
+    // behind it are all occluded
+    float blockDepthAt(int x, int y) { return blockDepth[x / kBlockSize + (y / kBlockSize) * blocksX]; };
+    template <depthFormat Format>
+    void updateBlockDepth(int x, int y);
+
+    // fast clear: clearBuffers only starts a new clear generation and
+    // blocks are cleared when they are first written to. The getters
+    // resolve the untouched blocks to the clear values.
+    void touchBlock(int x, int y)
+    {
+        const int block = x / kBlockSize + (y / kBlockSize) * blocksX;
+        if (blockGeneration[block] != clearGeneration)
+            clearBlock(block);
+    };
+
     rasterizerStats stats{0};
 
 private:
     unsigned int viewportWidth{0};
     unsigned int viewportHeight{0};
     std::vector<color> frameBuffer;
-    std::vector<float> depthBuffer;
+    depthFormat m_depthFormat{kDepthFloat};
+    std::vector<float> depthBuffer; // only the buffer of the depth format is allocated
+    std::vector<u_int32_t> depthBuffer24{};
+    std::vector<u_int16_t> depthBuffer16{};
+    template <typename F>
+    void withDepthBuffer(F f);
+    int blocksX{0};
+    int blocksY{0};
+    std::vector<float> blockDepth; // addressed [x + y*blocksX]
+    unsigned long int clearGeneration{0};
+    std::vector<unsigned long int> blockGeneration; // clear generation of the contents, addressed [x + y*blocksX]
+    void clearBlock(int block);
+    void clearUntouchedBlocks();
+
+    bool tiled{false};
+    size_t bufferSize() const { return tiled ? blocksX * blocksY * kBlockSize * kBlockSize : viewportWidth * viewportHeight; };
+    template <typename T>
+    void copyBlocks(const std::vector<T> &from, std::vector<T> &to, bool toTiled, T clearValue) const;
+    template <typename T>
+    T *resolve(std::vector<T> &buffer, std::vector<T> &linear, T clearValue);
+    std::vector<color> linearFrameBuffer{};
+    std::vector<float> linearDepthBuffer{};
+    std::vector<u_int32_t> linearVisibilityBuffer{};
+
+    bool visibility{false};
+    std::vector<u_int32_t> visibilityBuffer{}; // triangle ids, addressed [pixelIndex(x, y)]
+
+    fillMode m_fillMode{kSimd};
+
+    bool binning{false};
+    int tilesX{0};
+    int tilesY{0};
+    std::unique_ptr<threadPool> pool{nullptr};
+    void startPool(unsigned int threads);
+    // plotTriangle to a rasterizer (this or a slice) for a tile
+    std::vector<std::function<void(rasterizer *, const tile &, rasterizerStats &)>> triangles{};
+    std::vector<std::vector<u_int32_t>> bins{}; // triangle indices in submission order
+    std::vector<rasterizerStats> binStats{};
+    std::vector<std::function<void()>> overlays{}; // lines and points after the triangles
+    bool deferred() const { return binning || sortLast || unordered; };
+    void stopThreads();
+
+    bool sortLast{false};
+    std::vector<std::unique_ptr<rasterizer>> slices{}; // the buffers of the sort-last threads
+    std::vector<depthTest> sliceDepthTests{}; // the depth tests of the triangles, addressed like triangles
+    void drawSlices();
+    void drawSliceRun(size_t begin, size_t end, depthTest run);
+    const rasterizer *seed{nullptr}; // a slice clears its blocks to the touched blocks of this
+    template <depthFormat Format>
+    void compositeSlices(bool depthOnly);
+    void compositeShadedSlices();
+
+    bool unordered{false};
+    std::unique_ptr<std::atomic<u_int64_t>[]> packedBuffer{}; // addressed [pixelIndex(x, y)]
+    template <depthFormat Format>
+    void drawPacked();
+
+    void plotPoint(const vec3 &point, const color rgba_color);
     rasterizer(); // hide default constructor so that we get width and height
 };
 
 // fwd decl
 void plotLine(const vec3 &from, const vec3 &to, const color rgba_color, rasterizer *rasterizer);
-void plotTriangle(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, lambdaShader fragmentShader);
+template <depthFormat Format>
+void plotLine(const vec3 &from, const vec3 &to, const color rgba_color, rasterizer *rasterizer);
+bool clipLine(vec3 &from, vec3 &to, const float maxX, const float maxY);
+template <typename Shader, statsLevel Stats = kRasterizerStats>
+void plotTriangle(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader, depthTest depthTest, const tile &bounds, rasterizerStats &stats);
+bool triangleBounds(const vec3 (&vertices)[3], const tile &clip, tile &bounds);
 
 // method implementations
 
 void rasterizer::clearBuffers()
 {
-    std::fill(frameBuffer.begin(), frameBuffer.end(), minity::black);
-    std::fill(depthBuffer.begin(), depthBuffer.end(), std::numeric_limits<float>::infinity());
+    // O(blocks) instead of O(pixels), the pixels are cleared on first touch
+    clearGeneration++;
+    std::fill(blockDepth.begin(), blockDepth.end(), std::numeric_limits<float>::infinity());
     stats = rasterizerStats{};
+    triangles.clear();
+    sliceDepthTests.clear();
+    for (auto &bin : bins)
+        bin.clear();
+    overlays.clear();
+};
+void rasterizer::startPool(unsigned int threads)
+{
+    if (threads == 0)
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    if (!pool || pool->size() != threads)
+        pool = std::make_unique<threadPool>(threads);
+};
+// leaves the multithreaded mode (binned, sort-last or unordered)
+void rasterizer::stopThreads()
+{
+    binning = false;
+    sortLast = false;
+    slices.clear();
+    unordered = false;
+    packedBuffer.reset();
+    pool.reset();
+};
+void rasterizer::setBinning(bool enabled, unsigned int threads)
+{
+    finishFrame();
+    if (!enabled)
+    {
+        if (binning)
+            stopThreads();
+        return;
+    }
+
+    stopThreads();
+    binning = true;
+    startPool(threads);
+
+    tilesX = (viewportWidth + kTileSize - 1) / kTileSize;
+    tilesY = (viewportHeight + kTileSize - 1) / kTileSize;
+    bins.resize(tilesX * tilesY);
+    binStats.resize(tilesX * tilesY);
+};
+void rasterizer::setVisibilityBuffer(bool enabled)
+{
+    finishFrame();
+    visibility = enabled;
+    visibilityBuffer = std::vector<u_int32_t>(enabled ? bufferSize() : 0, kNoTriangle);
+    for (auto &slice : slices)
+        slice->setVisibilityBuffer(enabled);
+};
+void rasterizer::setSortLast(bool enabled, unsigned int threads)
+{
+    finishFrame();
+    if (!enabled)
+    {
+        if (sortLast)
+            stopThreads();
+        return;
+    }
+
+    stopThreads();
+    sortLast = true;
+    startPool(threads);
+    // the setters keep the slices in the modes of this rasterizer
+    for (unsigned int i = 0; i < pool->size(); ++i)
+    {
+        slices.push_back(std::make_unique<rasterizer>(viewportWidth, viewportHeight));
+        slices.back()->setTiledLayout(tiled);
+        slices.back()->setDepthFormat(m_depthFormat);
+        slices.back()->setFillMode(m_fillMode);
+        slices.back()->setVisibilityBuffer(visibility);
+    }
+};
+void rasterizer::setUnordered(bool enabled, unsigned int threads)
+{
+    finishFrame();
+    if (!enabled)
+    {
+        if (unordered)
+            stopThreads();
+        return;
+    }
+
+    stopThreads();
+    unordered = true;
+    startPool(threads);
+    // large enough for both layouts
+    packedBuffer = std::make_unique<std::atomic<u_int64_t>[]>(blocksX * blocksY * kBlockSize * kBlockSize);
+};
+u_int32_t *rasterizer::getVisibilityBuffer() { finishFrame(); return resolve(visibilityBuffer, linearVisibilityBuffer, kNoTriangle); };
+
+void rasterizer::setTiledLayout(bool enabled)
+{
+    finishFrame();
+    if (enabled == tiled)
+        return;
+    clearUntouchedBlocks(); // no clear values needed below
+    auto relayout = [&](auto &buffer) {
+        std::remove_reference_t<decltype(buffer)> converted;
+        copyBlocks(buffer, converted, enabled, {});
+        buffer.swap(converted);
+    };
+    relayout(frameBuffer);
+    withDepthBuffer([&](auto &buffer, auto) { relayout(buffer); });
+    if (visibility)
+        relayout(visibilityBuffer);
+    tiled = enabled;
+    for (auto &slice : slices)
+        slice->setTiledLayout(enabled);
+};
+
+// copies every row of every block with one memcpy, blocks on the right
+// and bottom edge of the viewport are partially outside and padded.
+// Blocks not touched since the last clear are filled with clearValue.
+template <typename T>
+void rasterizer::copyBlocks(const std::vector<T> &from, std::vector<T> &to, bool toTiled, T clearValue) const
+{
+    to.resize(toTiled ? blocksX * blocksY * kBlockSize * kBlockSize : viewportWidth * viewportHeight);
+    for (int blockY = 0; blockY < blocksY; ++blockY)
+        for (int blockX = 0; blockX < blocksX; ++blockX)
+        {
+            const size_t block = (blockX + blockY * blocksX) * kBlockSize * kBlockSize;
+            const int width = std::min(kBlockSize, (int)viewportWidth - blockX * kBlockSize);
+            const int height = std::min(kBlockSize, (int)viewportHeight - blockY * kBlockSize);
+            const bool cleared = blockGeneration[blockX + blockY * blocksX] != clearGeneration;
+            for (int row = 0; row < height; ++row)
+            {
+                const size_t tiledRow = block + row * kBlockSize;
+                const size_t linearRow = blockX * kBlockSize + (blockY * kBlockSize + row) * viewportWidth;
+                if (cleared)
+                    std::fill_n(&to[toTiled ? tiledRow : linearRow], width, clearValue);
+                else if (toTiled)
+                    std::memcpy(&to[tiledRow], &from[linearRow], width * sizeof(T));
+                else
+                    std::memcpy(&to[linearRow], &from[tiledRow], width * sizeof(T));
+            }
+        }
+}
+
+template <typename T>
+T *rasterizer::resolve(std::vector<T> &buffer, std::vector<T> &linear, T clearValue)
+{
+    if (buffer.empty())
+        return buffer.data();
+    if (tiled)
+    {
+        copyBlocks(buffer, linear, false, clearValue);
+        return linear.data();
+    }
+
+    // untouched blocks stay untouched (their other buffers are not cleared),
+    // consecutive ones are filled as one run per row
+    for (unsigned int y = 0; y < viewportHeight; ++y)
+    {
+        const unsigned long int *generation = &blockGeneration[(y / kBlockSize) * blocksX];
+        for (int first = 0; first < blocksX;)
+        {
+            if (generation[first] == clearGeneration)
+            {
+                first++;
+                continue;
+            }
+            int last = first;
+            while (last + 1 < blocksX && generation[last + 1] != clearGeneration)
+                last++;
+            const unsigned int end = std::min((last + 1) * kBlockSize, (int)viewportWidth);
+            std::fill(&buffer[first * kBlockSize + y * viewportWidth], &buffer[0] + end + y * viewportWidth, clearValue);
+            first = last + 1;
+        }
+    }
+    return buffer.data();
+}
+
+void rasterizer::clearBlock(int block)
+{
+    const int blockX = block % blocksX;
+    const int blockY = block / blocksX;
+    const int width = std::min(kBlockSize, (int)viewportWidth - blockX * kBlockSize);
+    const int height = std::min(kBlockSize, (int)viewportHeight - blockY * kBlockSize);
+    if (seed && seed->blockGeneration[block] == seed->clearGeneration)
+    {
+        // a sort-last slice of an equal depth run starts with the block of the seed
+        auto copyRows = [&](auto buffer) {
+            if ((this->*buffer).empty())
+                return; // e.g. only the buffer of the depth format is allocated
+            for (int row = 0; row < height; ++row)
+            {
+                const size_t first = pixelIndex(blockX * kBlockSize, blockY * kBlockSize + row);
+                std::copy_n(&(seed->*buffer)[first], width, &(this->*buffer)[first]);
+            }
+        };
+        copyRows(&rasterizer::frameBuffer);
+        copyRows(&rasterizer::visibilityBuffer);
+        copyRows(&rasterizer::depthBuffer);
+        copyRows(&rasterizer::depthBuffer24);
+        copyRows(&rasterizer::depthBuffer16);
+        blockDepth[block] = seed->blockDepth[block];
+        blockGeneration[block] = clearGeneration;
+        return;
+    }
+    withDepthBuffer([&](auto &depth, auto traits) {
+        for (int row = 0; row < height; ++row)
+        {
+            const size_t first = pixelIndex(blockX * kBlockSize, blockY * kBlockSize + row);
+            std::fill_n(&frameBuffer[first], width, minity::black);
+            std::fill_n(&depth[first], width, decltype(traits)::clear);
+            if (visibility)
+                std::fill_n(&visibilityBuffer[first], width, kNoTriangle);
+        }
+    });
+    blockGeneration[block] = clearGeneration;
+}
+void rasterizer::clearUntouchedBlocks()
+{
+    for (int block = 0; block < blocksX * blocksY; ++block)
+        if (blockGeneration[block] != clearGeneration)
+            clearBlock(block);
+}
+
+/**
+ * @brief deferred shading pass of the visibility buffer mode
+ *
+ * Calls shade(x, y, id) once for every pixel that has a visible triangle
+ * and writes the returned color to the frame buffer. The rows are shaded
+ * by the thread pool of the binned mode if there is one.
+ *
+ * @tparam Shade callable minity::color(int x, int y, u_int32_t id)
+ */
+template <typename Shade>
+void rasterizer::shadeVisibilityBuffer(Shade shade)
+{
+    finishFrame();
+    if (!visibility)
+        return;
+    clearUntouchedBlocks(); // the whole buffer is read
+
+    std::vector<unsigned long int> rowShaded(viewportHeight, 0);
+    auto shadeRow = [&](size_t y) {
+        for (unsigned int x = 0; x < viewportWidth; ++x)
+        {
+            const size_t i = pixelIndex(x, y);
+            if (visibilityBuffer[i] == kNoTriangle)
+                continue;
+            frameBuffer[i] = shade((int)x, (int)y, visibilityBuffer[i]);
+            rowShaded[y]++;
+        }
+    };
+    if (pool)
+        pool->parallelFor(viewportHeight, shadeRow);
+    else
+        for (size_t y = 0; y < viewportHeight; ++y)
+            shadeRow(y);
+
+    for (auto shaded : rowShaded)
+        statsPolicy<kRasterizerStats>::pixel(stats.shaded, shaded);
+};
+void rasterizer::finishFrame()
+{
+    if (triangles.empty() && overlays.empty())
+        return;
+
+    if (sortLast || unordered)
+    {
+        if (sortLast)
+            drawSlices();
+        else if (!triangles.empty())
+        {
+            switch (m_depthFormat)
+            {
+            case kDepthReversedFloat:
+                drawPacked<kDepthReversedFloat>();
+                break;
+            case kDepthUnorm24:
+                drawPacked<kDepthUnorm24>();
+                break;
+            case kDepthUnorm16:
+                drawPacked<kDepthUnorm16>();
+                break;
+            default:
+                drawPacked<kDepthFloat>();
+            }
+        }
+        for (auto &overlay : overlays)
+            overlay();
+        overlays.clear();
+        return;
+    }
+
+    // every tile goes to one thread which draws the triangles
+    // in submission order, so the result is deterministic
+    pool->parallelFor(bins.size(), [this](size_t i) {
+        tile bounds{};
+        bounds.minX = (i % tilesX) * kTileSize;
+        bounds.minY = (i / tilesX) * kTileSize;
+        bounds.maxX = std::min(bounds.minX + kTileSize, (int)viewportWidth) - 1;
+        bounds.maxY = std::min(bounds.minY + kTileSize, (int)viewportHeight) - 1;
+        binStats[i] = rasterizerStats{};
+        for (auto index : bins[i])
+            triangles[index](this, bounds, binStats[i]);
+        bins[i].clear();
+    });
+    if (kRasterizerStats != kNoStats)
+        for (auto &tileStats : binStats)
+            stats += tileStats;
+    triangles.clear();
+
+    for (auto &overlay : overlays)
+        overlay();
+    overlays.clear();
+};
+void rasterizer::drawSlices()
+{
+    // the kEqualDepth triangles are tested against the depth of all the
+    // triangles before them and the kDepthOnly triangles leave the color,
+    // so the runs of the early (or late), depth only and equal depth
+    // triangles are drawn and composited one after the other
+    auto runOf = [this](size_t t) {
+        return sliceDepthTests[t] == kLateDepthTest ? kEarlyDepthTest : sliceDepthTests[t];
+    };
+    for (size_t begin = 0, end = 0; begin < triangles.size(); begin = end)
+    {
+        const depthTest run = runOf(begin);
+        while (end < triangles.size() && runOf(end) == run)
+            ++end;
+        drawSliceRun(begin, end, run);
+    }
+    triangles.clear();
+    sliceDepthTests.clear();
+};
+void rasterizer::drawSliceRun(size_t begin, size_t end, depthTest run)
+{
+    // every slice draws its range with plotTriangle like the direct mode,
+    // the equal depth test needs the depth of this rasterizer (see clearBlock)
+    const size_t count = slices.size();
+    pool->parallelFor(count, [this, begin, end, count, run](size_t i) {
+        rasterizer &slice = *slices[i];
+        slice.seed = run == kEqualDepth ? this : nullptr;
+        slice.clearBuffers();
+        const tile viewport{0, 0, (int)viewportWidth - 1, (int)viewportHeight - 1};
+        for (size_t t = begin + (end - begin) * i / count; t < begin + (end - begin) * (i + 1) / count; ++t)
+            triangles[t](&slice, viewport, slice.stats);
+    });
+    if (kRasterizerStats != kNoStats)
+        for (auto &slice : slices)
+            stats += slice->stats;
+
+    if (run == kEqualDepth)
+    {
+        compositeShadedSlices();
+        return;
+    }
+    switch (m_depthFormat)
+    {
+    case kDepthReversedFloat:
+        compositeSlices<kDepthReversedFloat>(run == kDepthOnly);
+        break;
+    case kDepthUnorm24:
+        compositeSlices<kDepthUnorm24>(run == kDepthOnly);
+        break;
+    case kDepthUnorm16:
+        compositeSlices<kDepthUnorm16>(run == kDepthOnly);
+        break;
+    default:
+        compositeSlices<kDepthFloat>(run == kDepthOnly);
+    }
+};
+/**
+ * @brief depth composite the buffers of the sort-last slices
+ *
+ * The slices are merged in their order with the depth test of the format,
+ * so a later slice wins a tie like a later triangle does and the result is
+ * the same as drawing all triangles to one buffer. The rows of blocks are
+ * composited by the thread pool, kSimdLanes pixels at a time, and blocks a
+ * slice did not touch since its clear are skipped.
+ *
+ * @param depthOnly the slices drew kDepthOnly triangles, only the depth is
+ *        taken and the color is kept like in the direct mode
+ */
+template <depthFormat Format>
+void rasterizer::compositeSlices(bool depthOnly)
+{
+    typedef depthTraits<Format> traits;
+    pool->parallelFor(blocksY, [this, depthOnly](size_t blockY) {
+        for (int blockX = 0; blockX < blocksX; ++blockX)
+        {
+            const int block = blockX + blockY * blocksX;
+            const int minX = blockX * kBlockSize;
+            const int minY = blockY * kBlockSize;
+            const int width = std::min(kBlockSize, (int)viewportWidth - minX);
+            const int height = std::min(kBlockSize, (int)viewportHeight - minY);
+            bool touched{false};
+            for (auto &slice : slices)
+            {
+                if (slice->blockGeneration[block] != slice->clearGeneration)
+                    continue;
+                touched = true;
+                touchBlock(minX, minY);
+                for (int y = minY; y < minY + height; ++y)
+                {
+                    const typename traits::type *fromDepth = slice->template depthBufferAt<Format>(minX, y);
+                    const color *fromColor = slice->colorTargetAt(minX, y);
+                    typename traits::type *depth = depthBufferAt<Format>(minX, y);
+                    color *target = colorTargetAt(minX, y);
+                    for (int x = 0; x < width; x += kSimdLanes)
+                    {
+                        const int lanes = std::min(kSimdLanes, width - x);
+                        const auto stored = traits::load(depth + x, lanes);
+                        const auto incoming = traits::load(fromDepth + x, lanes);
+                        const intv passed = traits::passes(incoming, stored);
+                        traits::store(depth + x, select(passed, incoming, stored), lanes);
+                        if (!depthOnly)
+                            storeLanes(target + x, select(passed, loadLanes<intv>(fromColor + x, lanes), loadLanes<intv>(target + x, lanes)), lanes);
+                    }
+                }
+            }
+            if (touched)
+                updateBlockDepth<Format>(minX, minY);
+        }
+    });
+};
+/**
+ * @brief composite the colors the sort-last slices shaded with kEqualDepth
+ *
+ * The blocks the slices touched started as the blocks of this rasterizer
+ * (see clearBlock) and the equal test doesn't change the depth, so the
+ * pixels that differ from this rasterizer are the shaded ones. They are
+ * merged in the order of the slices, a later slice wins like a later
+ * triangle does. Blocks no slice touched since its clear are skipped.
+ */
+void rasterizer::compositeShadedSlices()
+{
+    pool->parallelFor(blocksY, [this](size_t blockY) {
+        const int minY = blockY * kBlockSize;
+        const int height = std::min(kBlockSize, (int)viewportHeight - minY);
+        std::vector<rasterizer *> touched{};
+        for (int blockX = 0; blockX < blocksX; ++blockX)
+        {
+            const int block = blockX + blockY * blocksX;
+            touched.clear();
+            for (auto &slice : slices)
+                if (slice->blockGeneration[block] == slice->clearGeneration)
+                    touched.push_back(slice.get());
+            if (touched.empty())
+                continue;
+
+            const int minX = blockX * kBlockSize;
+            const int width = std::min(kBlockSize, (int)viewportWidth - minX);
+            touchBlock(minX, minY); // an untouched block was cleared in the slices
+            for (int y = minY; y < minY + height; ++y)
+            {
+                color *target = colorTargetAt(minX, y);
+                for (int x = 0; x < width; x += kSimdLanes)
+                {
+                    const int lanes = std::min(kSimdLanes, width - x);
+                    const intv stored = loadLanes<intv>(target + x, lanes);
+                    intv shaded = stored;
+                    for (auto slice : touched)
+                    {
+                        const intv incoming = loadLanes<intv>(slice->colorTargetAt(minX, y) + x, lanes);
+                        shaded = select(incoming != stored, incoming, shaded);
+                    }
+                    storeLanes(target + x, shaded, lanes);
+                }
+            }
+        }
+    });
 };
-void rasterizer::drawTriangle(const vec3 (&vertices)[3], const color rgba_color, lambdaShader fragmentShader)
+/**
+ * @brief draw the triangles of the unordered mode
+ *
+ * The buffers are packed to the words of the pixels, the triangles are
+ * drawn in chunks by the thread pool (see fillPacked) and the words are
+ * unpacked again. Packing and unpacking run over the rows of blocks, which
+ * are contiguous in both layouts.
+ */
+template <depthFormat Format>
+void rasterizer::drawPacked()
+{
+    typedef depthTraits<Format> traits;
+    // the blocks can not be cleared on first touch by concurrent threads
+    clearUntouchedBlocks();
+    color *target = visibility ? visibilityBuffer.data() : frameBuffer.data();
+    typename traits::type *depth = depthBufferAt<Format>(0, 0);
+    const size_t blockRow = tiled ? blocksX * kBlockSize * kBlockSize : viewportWidth * kBlockSize;
+    const size_t size = bufferSize();
+
+    pool->parallelFor(blocksY, [&](size_t blockY) {
+        for (size_t i = blockY * blockRow; i < std::min((blockY + 1) * blockRow, size); ++i)
+            packedBuffer[i].store(packPixel(traits::ordered(depth[i]), target[i]), std::memory_order_relaxed);
+    });
+
+    // a few chunks per thread even out the triangle sizes
+    const tile viewport{0, 0, (int)viewportWidth - 1, (int)viewportHeight - 1};
+    const size_t chunks = std::min<size_t>(triangles.size(), pool->size() * 16);
+    std::vector<rasterizerStats> chunkStats(chunks);
+    pool->parallelFor(chunks, [&](size_t chunk) {
+        for (size_t t = triangles.size() * chunk / chunks; t < triangles.size() * (chunk + 1) / chunks; ++t)
+            triangles[t](this, viewport, chunkStats[chunk]);
+    });
+    if (kRasterizerStats != kNoStats)
+        for (auto &chunk : chunkStats)
+            stats += chunk;
+    triangles.clear();
+
+    pool->parallelFor(blocksY, [&](size_t blockY) {
+        for (size_t i = blockY * blockRow; i < std::min((blockY + 1) * blockRow, size); ++i)
+        {
+            const u_int64_t pixel = packedBuffer[i].load(std::memory_order_relaxed);
+            depth[i] = traits::fromOrdered(static_cast<u_int32_t>(pixel >> 32));
+            target[i] = static_cast<color>(pixel);
+        }
+        for (int blockX = 0; blockX < blocksX; ++blockX)
+            updateBlockDepth<Format>(blockX * kBlockSize, blockY * kBlockSize);
+    });
+};
+void rasterizer::drawTriangle(const vec3 (&vertices)[3], const color rgba_color)
+{
+    drawTriangle(vertices, rgba_color, nullShader);
+};
+template <typename Shader>
+void rasterizer::drawTriangle(const vec3 (&vertices)[3], const color rgba_color, Shader fragmentShader, depthTest depthTest)
 {
     if (debugRasterizer)
         std::cout << "drawTriangle: " << vertices[0] << " " << vertices[1] << " " << vertices[2] << std::endl;
-    plotTriangle(vertices, rgba_color, this, fragmentShader);
-    stats.triangles++;
+    statsPolicy<kRasterizerStats>::frame(stats.triangles);
+
+    tile viewport{0, 0, (int)viewportWidth - 1, (int)viewportHeight - 1};
+    if (!deferred())
+    {
+        plotTriangle(vertices, rgba_color, this, fragmentShader, depthTest, viewport, stats);
+        return;
+    }
+    // the shader is run later, so it must not capture locals by reference
+    auto plot = [=](rasterizer *target, const tile &clip, rasterizerStats &tileStats) {
+        plotTriangle(vertices, rgba_color, target, fragmentShader, depthTest, clip, tileStats);
+    };
+    if (!binning)
+    {
+        triangles.push_back(plot); // drawn to the whole viewport
+        if (sortLast)
+            sliceDepthTests.push_back(depthTest);
+        return;
+    }
+
+    tile bounds{};
+    if (!triangleBounds(vertices, viewport, bounds))
+    {
+        statsPolicy<kRasterizerStats>::frame(stats.culled);
+        return; // nothing to draw inside the viewport
+    }
+
+    u_int32_t index = triangles.size();
+    triangles.push_back(plot);
+    for (int ty = bounds.minY / kTileSize; ty <= bounds.maxY / kTileSize; ty++)
+        for (int tx = bounds.minX / kTileSize; tx <= bounds.maxX / kTileSize; tx++)
+            bins[tx + ty * tilesX].push_back(index);
 };
 void rasterizer::drawLine(const vec3 &from, const vec3 &to, const color rgba_color)
 {
-    // clipping #3 to viewport/projection space
-    if (debugRasterizer)
-        std::cout << "drawLine: " << from << "->" << to << std::endl;
-    if (from.x < 0 || from.x >= viewportWidth || from.y < 0 || from.y >= viewportHeight
-        || to.x < 0 || to.x >= viewportWidth || to.y < 0 || to.y >= viewportHeight)
+    const std::array<vec3, 2> line{from, to};
+    drawLines(&line, 1, rgba_color);
+};
+void rasterizer::drawLines(const std::array<vec3, 2> *lines, size_t count, const color rgba_color)
+{
+    // clipping #3 to viewport/projection space, the pixel of x is (int)x
+    const float maxX = std::nextafter(static_cast<float>(viewportWidth), 0.0f);
+    const float maxY = std::nextafter(static_cast<float>(viewportHeight), 0.0f);
+    std::vector<std::array<vec3, 2>> clipped{};
+    clipped.reserve(count);
+    for (size_t i = 0; i < count; ++i)
     {
-        stats.xyClipped++;
-        return; // we're outside the viewport
+        vec3 from = lines[i][0];
+        vec3 to = lines[i][1];
+        if (debugRasterizer)
+            std::cout << "drawLine: " << from << "->" << to << std::endl;
+        if (!clipLine(from, to, maxX, maxY))
+        {
+            statsPolicy<kRasterizerStats>::frame(stats.xyClipped);
+            continue; // we're outside the viewport
+        }
+        statsPolicy<kRasterizerStats>::frame(stats.lines);
+        clipped.push_back({from, to});
     }
 
-    plotLine(from, to, rgba_color, this);
-    stats.lines++;
+    auto plot = [this, rgba_color](const std::vector<std::array<vec3, 2>> &segments) {
+        for (auto &segment : segments)
+            plotLine(segment[0], segment[1], rgba_color, this);
+    };
+    if (deferred())
+    {
+        overlays.emplace_back([=]() { plot(clipped); });
+        return;
+    }
+    plot(clipped);
 };
 void rasterizer::drawPoint(const vec3 &point, color rgba_color)
 {
     // assert(0 <= point.x && point.x <= viewportWidth);
     // assert(0 <= point.y && point.y <= viewportHeight);
 
+    if (deferred())
+    {
+        // keep the draw order with the binned triangles
+        overlays.emplace_back([=]() { plotPoint(point, rgba_color); });
+        return;
+    }
+    plotPoint(point, rgba_color);
+};
+void rasterizer::plotPoint(const vec3 &point, color rgba_color)
+{
     int x = (int)point.x;
     int y = (int)point.y;
 
@@ -96,131 +944,229 @@ void rasterizer::drawPoint(const vec3 &point, color rgba_color)
     // clipping #3 to viewport/projection space
     if (x < 0 || x >= (int)viewportWidth || y < 0 || y >= (int)viewportHeight)
     {
-        stats.xyClipped++;
+        statsPolicy<kRasterizerStats>::frame(stats.xyClipped);
         if (debugRasterizer)
             std::cout << "clipped" << std::endl;
         return; // we're outside the viewport
     }
 
-    // z-check
-    if (point.z <= depthBuffer[x + y * viewportWidth])
+    writePixel(x, y, point.z, rgba_color, stats);
+};
+bool rasterizer::testDepth(int x, int y, float z)
+{
+    switch (m_depthFormat)
     {
-        frameBuffer[x + y * viewportWidth] = rgba_color;
-        depthBuffer[x + y * viewportWidth] = point.z;
-        stats.points++;
-        if (debugRasterizer)
-            std::cout << "drawn" << std::endl;
+    case kDepthReversedFloat:
+        return testDepth<kDepthReversedFloat>(x, y, z);
+    case kDepthUnorm24:
+        return testDepth<kDepthUnorm24>(x, y, z);
+    case kDepthUnorm16:
+        return testDepth<kDepthUnorm16>(x, y, z);
+    default:
+        return testDepth<kDepthFloat>(x, y, z);
     }
-    else
+};
+void rasterizer::writePixel(int x, int y, float z, color rgba_color, rasterizerStats &pixelStats)
+{
+    switch (m_depthFormat)
     {
-        stats.depth++;
-        if (debugRasterizer)
-            std::cout << "z-clipped" << std::endl;
+    case kDepthReversedFloat:
+        return writePixel<kDepthReversedFloat>(x, y, z, rgba_color, pixelStats);
+    case kDepthUnorm24:
+        return writePixel<kDepthUnorm24>(x, y, z, rgba_color, pixelStats);
+    case kDepthUnorm16:
+        return writePixel<kDepthUnorm16>(x, y, z, rgba_color, pixelStats);
+    default:
+        return writePixel<kDepthFloat>(x, y, z, rgba_color, pixelStats);
+    }
+};
+color *rasterizer::getFramebuffer() { finishFrame(); return resolve(frameBuffer, linearFrameBuffer, minity::black); };
+float *rasterizer::getDepthbuffer()
+{
+    finishFrame();
+    float *linear{nullptr};
+    withDepthBuffer([&](auto &buffer, auto traits) {
+        typedef decltype(traits) format;
+        if constexpr (std::is_same<typename format::type, float>::value)
+        {
+            linear = resolve(buffer, linearDepthBuffer, format::clear);
+        }
+        else
+        {
+            std::vector<typename format::type> resolved{};
+            const typename format::type *stored = resolve(buffer, resolved, format::clear);
+            linearDepthBuffer.resize(viewportWidth * viewportHeight);
+            for (size_t i = 0; i < linearDepthBuffer.size(); ++i)
+                linearDepthBuffer[i] = format::decode(stored[i]);
+            linear = linearDepthBuffer.data();
+        }
+    });
+    return linear;
+};
+void rasterizer::setDepthFormat(depthFormat format)
+{
+    finishFrame();
+    if (format == m_depthFormat)
+        return;
+    depthBuffer.clear();
+    depthBuffer24.clear();
+    depthBuffer16.clear();
+    m_depthFormat = format;
+    withDepthBuffer([&](auto &buffer, auto traits) { buffer.assign(bufferSize(), decltype(traits)::clear); });
+    std::fill(blockDepth.begin(), blockDepth.end(), std::numeric_limits<float>::infinity());
+    for (auto &slice : slices)
+        slice->setDepthFormat(format);
+};
+// calls f(buffer, depthTraits<format>{}) with the buffer of the depth format
+template <typename F>
+void rasterizer::withDepthBuffer(F f)
+{
+    switch (m_depthFormat)
+    {
+    case kDepthReversedFloat:
+        f(depthBuffer, depthTraits<kDepthReversedFloat>{});
+        break;
+    case kDepthUnorm24:
+        f(depthBuffer24, depthTraits<kDepthUnorm24>{});
+        break;
+    case kDepthUnorm16:
+        f(depthBuffer16, depthTraits<kDepthUnorm16>{});
+        break;
+    default:
+        f(depthBuffer, depthTraits<kDepthFloat>{});
     }
 };
-color *rasterizer::getFramebuffer() { return (color *)frameBuffer.data(); };
-float *rasterizer::getDepthbuffer() { return (float *)depthBuffer.data(); };
+
+// the depth can only get nearer, so pixels written outside the triangle
+// fill (points and lines) leave the block depth a safe upper bound and
+// only the triangle fill has to call this after writing to a block
+template <depthFormat Format>
+void rasterizer::updateBlockDepth(int x, int y)
+{
+    typedef depthTraits<Format> traits;
+    const int blockX = x / kBlockSize;
+    const int blockY = y / kBlockSize;
+    const int maxX = std::min((blockX + 1) * kBlockSize, (int)viewportWidth);
+    const int maxY = std::min((blockY + 1) * kBlockSize, (int)viewportHeight);
+    float farthest{-std::numeric_limits<float>::infinity()};
+    for (int row = blockY * kBlockSize; row < maxY; ++row)
+    {
+        const typename traits::type *depth = depthBufferAt<Format>(blockX * kBlockSize, row);
+        for (int column = 0; column < maxX - blockX * kBlockSize; ++column)
+            farthest = std::max(farthest, traits::farthestKey(depth[column]));
+    }
+    blockDepth[blockX + blockY * blocksX] = farthest;
+}
 unsigned int rasterizer::getViewportWidth() { return viewportWidth; };
 unsigned int rasterizer::getViewportHeight() { return viewportHeight; };
 
+/**
+ * @brief clip a line to the rectangle [0, maxX] x [0, maxY] (Liang-Barsky)
+ *
+ * The parts of the line outside are cut off, z is interpolated to the
+ * new end points.
+ *
+ * @param from vec3 in screen coordinates, moved to the rectangle
+ * @param to vec3 in screen coordinates, moved to the rectangle
+ * @return false if no part of the line is inside
+ *
+ * @see https://en.wikipedia.org/wiki/Liang%E2%80%93Barsky_algorithm
+ */
+bool clipLine(vec3 &from, vec3 &to, const float maxX, const float maxY)
+{
+    if (!std::isfinite(from.x) || !std::isfinite(from.y) || !std::isfinite(to.x) || !std::isfinite(to.y))
+        return false;
+
+    // the line is from + t * (to - from) for t in [t0, t1],
+    // every edge limits t with p * t <= q
+    const vec3 delta{to.x - from.x, to.y - from.y, to.z - from.z};
+    const float p[4]{-delta.x, delta.x, -delta.y, delta.y};
+    const float q[4]{from.x, maxX - from.x, from.y, maxY - from.y};
+    float t0{0.0f};
+    float t1{1.0f};
+    for (int edge = 0; edge < 4; ++edge)
+    {
+        if (p[edge] == 0.0f)
+        {
+            if (q[edge] < 0.0f)
+                return false; // parallel to the edge and outside
+            continue;
+        }
+        const float t = q[edge] / p[edge];
+        if (p[edge] < 0.0f)
+            t0 = std::max(t0, t); // entering
+        else
+            t1 = std::min(t1, t); // leaving
+    }
+    if (t0 > t1)
+        return false;
+
+    auto at = [&](float t) {
+        vec3 point = from;
+        point.x = std::min(std::max(from.x + t * delta.x, 0.0f), maxX);
+        point.y = std::min(std::max(from.y + t * delta.y, 0.0f), maxY);
+        point.z = from.z + t * delta.z;
+        return point;
+    };
+    if (t1 < 1.0f)
+        to = at(t1);
+    if (t0 > 0.0f)
+        from = at(t0);
+    return true;
+}
+
 /**
  * @brief draw line to framebuffer
  *
- * @param from vec3 in screen coordinates
- * @param to vec3 in screen coordinates
+ * DDA: the longer axis steps one pixel at a time and the other axis
+ * (16.16 fixed point) and z (float) are interpolated, so the line ends
+ * exactly at the pixel of to and the depth is not rounded.
+ *
+ * @param from vec3 in screen coordinates inside the viewport (see clipLine)
+ * @param to vec3 in screen coordinates inside the viewport
  * @param rgba_color minity::color with 0xrrggbbaa format
  * @param rasterizer pointer to the rasterizer instance to use (facilitate easier testing)
  *
- * @see https://en.wikipedia.org/wiki/Bresenham%27s_line_algorithm
- * @see https://www.geeksforgeeks.org/bresenhams-algorithm-for-3-d-line-drawing/
+ * @see https://en.wikipedia.org/wiki/Digital_differential_analyzer_(graphics_algorithm)
  */
 void plotLine(const vec3 &from, const vec3 &to, const color rgba_color, rasterizer *rasterizer)
 {
     assert(rasterizer);
 
-    int dx = abs(to.x - from.x);
-    int dy = abs(to.y - from.y);
-    int dz = abs(to.z - from.z);
-    int xs = (to.x > from.x) ? 1 : -1;
-    int ys = (to.y > from.y) ? 1 : -1;
-    int zs = (to.z > from.z) ? 1 : -1;
-
-    int x = from.x;
-    int y = from.y;
-    // TODO: this is not good, it squashes the Z-buffer quite a lot
-    // we can lose precision and depth order can be reversed
-    // for z1=1.2 and z2=1.4, the deeper z2 will still be drawn :-(
-    int z = from.z;
-    rasterizer->drawPoint(vec3{(float)x, (float)y, (float)z}, rgba_color);
-
-    if (dx >= dy && dx >= dz) // X-axis drives
-    {
-        int p1 = 2 * dy - dx;
-        int p2 = 2 * dz - dx;
-        while (x != (int)to.x)
-        {
-            x += xs;
-            if (p1 >= 0)
-            {
-                y += ys;
-                p1 -= 2 * dx;
-            }
-            if (p2 >= 0)
-            {
-                z += zs;
-                p2 -= 2 * dx;
-            }
-            p1 += 2 * dy;
-            p2 += 2 * dz;
-            rasterizer->drawPoint(vec3{(float)x, (float)y, (float)z}, rgba_color);
-        }
-    }
-    else if (dy >= dx && dy >= dz) // Y-axis drives
-    {
-        int p1 = 2 * dx - dy;
-        int p2 = 2 * dz - dy;
-        while (y != (int)to.y)
-        {
-            y += ys;
-            if (p1 >= 0)
-            {
-                x += xs;
-                p1 -= 2 * dy;
-            }
-            if (p2 >= 0)
-            {
-                z += zs;
-                p2 -= 2 * dy;
-            }
-            p1 += 2 * dx;
-            p2 += 2 * dz;
-            rasterizer->drawPoint(vec3{(float)x, (float)y, (float)z}, rgba_color);
-        }
-    }
-    else // Z-axis drives
+    switch (rasterizer->getDepthFormat())
     {
-        int p1 = 2 * dy - dz;
-        int p2 = 2 * dx - dz;
-        while (z != (int)to.z)
-        {
-            z += zs;
-            if (p1 >= 0)
-            {
-                y += ys;
-                p1 -= 2 * dz;
-            }
-            if (p2 >= 0)
-            {
-                x += xs;
-                p2 -= 2 * dz;
-            }
-            p1 += 2 * dy;
-            p2 += 2 * dx;
-            rasterizer->drawPoint(vec3{(float)x, (float)y, (float)z}, rgba_color);
-        }
+    case kDepthReversedFloat:
+        return plotLine<kDepthReversedFloat>(from, to, rgba_color, rasterizer);
+    case kDepthUnorm24:
+        return plotLine<kDepthUnorm24>(from, to, rgba_color, rasterizer);
+    case kDepthUnorm16:
+        return plotLine<kDepthUnorm16>(from, to, rgba_color, rasterizer);
+    default:
+        return plotLine<kDepthFloat>(from, to, rgba_color, rasterizer);
     }
 }
 
+template <depthFormat Format>
+void plotLine(const vec3 &from, const vec3 &to, const color rgba_color, rasterizer *rasterizer)
+{
+    const int x0 = from.x;
+    const int y0 = from.y;
+    const int x1 = to.x;
+    const int y1 = to.y;
+    const int steps = std::max(std::abs(x1 - x0), std::abs(y1 - y0));
+
+    // start in the middle of the pixel, the truncated step of the minor
+    // axis adds up to less than half a pixel over the whole line
+    const int64_t one{1 << 16};
+    int64_t x = x0 * one + one / 2;
+    int64_t y = y0 * one + one / 2;
+    const int64_t xStep = steps ? (x1 - x0) * one / steps : 0;
+    const int64_t yStep = steps ? (y1 - y0) * one / steps : 0;
+    const float zStep = steps ? (to.z - from.z) / steps : 0.0f;
+    for (int i = 0; i <= steps; ++i, x += xStep, y += yStep)
+        rasterizer->writePixel<Format>(x >> 16, y >> 16, from.z + zStep * i, rgba_color, rasterizer->stats);
+}
+
 // Barycentric:
 // https://gamedev.stackexchange.com/questions/23743/whats-the-most-efficient-way-to-find-barycentric-coordinates
 // http://www.sunshine2k.de/coding/java/TriangleRasterization/TriangleRasterization.html (2d)
@@ -284,81 +1230,813 @@ public:
     float invDenom;
 };
 
+// screen space vertices are snapped to a fixed point grid of 1/kSubpixelScale pixels
+const int kSubpixelBits{8};
+const int64_t kSubpixelScale{1 << kSubpixelBits};
+// coordinates are clamped to +-kMaxScreenCoordinate pixels, so that
+// the edge function products stay far from 64 bit overflow
+const float kMaxScreenCoordinate{16384.0f};
+
+// integer division rounding down/up for a positive divisor
+inline int64_t floorDivide(int64_t numerator, int64_t divisor)
+{
+    return numerator >= 0 ? numerator / divisor : -((divisor - 1 - numerator) / divisor);
+}
+inline int64_t ceilDivide(int64_t numerator, int64_t divisor)
+{
+    return -floorDivide(-numerator, divisor);
+}
+
+inline int64_t snapToSubpixel(float coordinate)
+{
+    coordinate = std::max(-kMaxScreenCoordinate, std::min(kMaxScreenCoordinate, coordinate));
+    return std::llround(coordinate * static_cast<float>(kSubpixelScale));
+}
+
 /**
- * @brief draw triangle to framebuffer
+ * @brief triangle setup for the edge function rasterizer
+ *
+ * Each edge gets a function E(x, y) = a * x + b * y + c which is zero on
+ * the edge and positive inside the triangle. The functions are linear, so
+ * moving one pixel right or down only adds a or b - no per pixel dot
+ * products like in barycentricCoordinates. Edge i is the one opposite to
+ * vertex i, so E_i / area is directly the barycentric weight of vertex i.
+ *
+ * The vertices are snapped to kSubpixelBits of sub-pixel precision and the
+ * functions are evaluated in 64 bit integers. The coverage is then exact:
+ * no rounding differences between the scalar and SIMD paths, threads or
+ * compilers, and no cracks or double hits along shared edges.
+ *
+ * Pixels whose center lies exactly on an edge follow the top-left fill rule
+ * (like D3D and OpenGL): they belong to the triangle only if the edge is a
+ * top edge or a left edge. Two triangles sharing an edge will then draw the
+ * shared pixels exactly once.
+ *
+ * @see https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/rasterization-stage.html
+ * @see https://fgiesen.wordpress.com/2013/02/08/triangle-rasterization-in-practice/
+ */
+struct edgeFunctions
+{
+public:
+    // calculate the edge functions once per triangle
+    // returns false for degenerate (zero area) triangles
+    bool prepare(const vec3 (&vertices)[3])
+    {
+        int64_t x[3];
+        int64_t y[3];
+        for (int i : {0, 1, 2})
+        {
+            if (!std::isfinite(vertices[i].x) || !std::isfinite(vertices[i].y))
+                return false;
+            x[i] = snapToSubpixel(vertices[i].x);
+            y[i] = snapToSubpixel(vertices[i].y);
+        }
+        for (int i : {0, 1, 2})
+        {
+            const int from = (i + 1) % 3;
+            const int to = (i + 2) % 3;
+            a[i] = y[to] - y[from];
+            b[i] = x[from] - x[to];
+            c[i] = -(a[i] * x[from] + b[i] * y[from]);
+        }
+        // twice the signed area, the sign depends on the winding
+        area = a[0] * x[0] + b[0] * y[0] + c[0];
+        if (area == 0)
+            return false;
+
+        // flip counter-clockwise (in screen space) triangles
+        // so that the inside of the triangle is always positive
+        if (area < 0)
+        {
+            for (int i : {0, 1, 2})
+            {
+                a[i] = -a[i];
+                b[i] = -b[i];
+                c[i] = -c[i];
+            }
+            area = -area;
+        }
+        invArea = 1.0f / static_cast<float>(area);
+
+        // (a, b) points inside, screen y grows down:
+        // left edge has the inside on its right (a > 0) and
+        // top edge is horizontal with the inside below it (b > 0)
+        for (int i : {0, 1, 2})
+        {
+            topLeft[i] = a[i] > 0 || (a[i] == 0 && b[i] > 0);
+            bias[i] = topLeft[i] ? 0 : -1;
+            stepX[i] = a[i] * kSubpixelScale;
+        }
+        return true;
+    }
+
+    // edge function i at the center of pixel x, y
+    // (taking the pixel corner produces tears e.g. in sphere)
+    int64_t at(int i, int x, int y) const
+    {
+        return a[i] * (x * kSubpixelScale + kSubpixelScale / 2) + b[i] * (y * kSubpixelScale + kSubpixelScale / 2) + c[i];
+    }
+
+    // with the top-left bias pixels on an edge are inside only for top and
+    // left edges, so the inside test is a sign check of all three functions
+    bool inside(const int64_t (&e)[3]) const
+    {
+        return ((e[0] + bias[0]) | (e[1] + bias[1]) | (e[2] + bias[2])) >= 0;
+    }
+
+    void barycentricAt(int x, int y, float &u, float &v, float &w) const
+    {
+        u = static_cast<float>(at(0, x, y)) * invArea;
+        v = static_cast<float>(at(1, x, y)) * invArea;
+        w = static_cast<float>(at(2, x, y)) * invArea;
+    }
+
+    // the inside pixels of row y are [first, last] (clipped to [minX, maxX]),
+    // solved from the sign changes of the edge functions along the row
+    bool span(int y, int minX, int maxX, int &first, int &last) const
+    {
+        int64_t from = minX;
+        int64_t to = maxX;
+        for (int i : {0, 1, 2})
+        {
+            // inside where e + stepX * (x - minX) >= 0
+            const int64_t e = at(i, minX, y) + bias[i];
+            if (stepX[i] > 0)
+                from = std::max(from, minX + ceilDivide(-e, stepX[i]));
+            else if (stepX[i] < 0)
+                to = std::min(to, minX + floorDivide(e, -stepX[i]));
+            else if (e < 0)
+                return false; // horizontal edge with the row outside
+        }
+        first = from;
+        last = to;
+        return from <= to;
+    }
+
+    enum coverage
+    {
+        kNone,
+        kPartial,
+        kFull
+    };
+
+    // the functions are linear, so their extremes over a block
+    // are at the corner pixels: if any edge has all of them outside
+    // the block is rejected and if all edges have all of them inside
+    // the block is fully covered
+    coverage blockCoverage(const tile &block) const
+    {
+        bool full{true};
+        for (int i : {0, 1, 2})
+        {
+            const int64_t e00 = at(i, block.minX, block.minY);
+            const int64_t e10 = at(i, block.maxX, block.minY);
+            const int64_t e01 = at(i, block.minX, block.maxY);
+            const int64_t e11 = at(i, block.maxX, block.maxY);
+            const int64_t eMin = std::min(std::min(e00, e10), std::min(e01, e11));
+            const int64_t eMax = std::max(std::max(e00, e10), std::max(e01, e11));
+            if (eMax + bias[i] < 0)
+                return kNone;
+            full = full && eMin + bias[i] >= 0;
+        }
+        return full ? kFull : kPartial;
+    }
+
+// leave the components public as
+// there's no real reason to hide them
+// private:
+    int64_t a[3]{0};
+    int64_t b[3]{0};
+    int64_t c[3]{0};
+    int64_t bias[3]{0}; // -1 for edges that are not top or left edges
+    int64_t stepX[3]{0}; // E(x + 1, y) - E(x, y)
+    bool topLeft[3]{false};
+    int64_t area{0};
+    float invArea{0};
+};
+
+/**
+ * @brief pixel bounding box of a triangle
+ *
+ * Pixel x is covered if its center x + 0.5 is inside the triangle,
+ * so only the pixels with their center within the (snapped) vertex
+ * extents count.
  *
  * @param vertices vec3[3] of triangle vertices in screen space
- * @param rgba_color minity::color with 0xrrggbbaa format
- * @param rasterizer pointer to the rasterizer instance to use (facilitate easier testing)
+ * @param clip bounds are limited to this area (e.g. viewport or tile)
+ * @param bounds the inclusive pixel bounds
+ * @return false if the bounding box is empty
  */
-void plotTriangle(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, lambdaShader fragmentShader)
+bool triangleBounds(const vec3 (&vertices)[3], const tile &clip, tile &bounds)
 {
-    const vec3 &v1 = vertices[0];
-    const vec3 &v2 = vertices[1];
-    const vec3 &v3 = vertices[2];
+    int64_t x[3];
+    int64_t y[3];
+    for (int i : {0, 1, 2})
+    {
+        if (!std::isfinite(vertices[i].x) || !std::isfinite(vertices[i].y))
+            return false;
+        x[i] = snapToSubpixel(vertices[i].x);
+        y[i] = snapToSubpixel(vertices[i].y);
+    }
+
+    // clipping #3 to viewport/projection space is done by limiting the bounding box
+    // (the shifts round towards negative infinity also for negative coordinates)
+    const int64_t half = kSubpixelScale / 2;
+    int64_t minX = -((half - std::min(x[0], std::min(x[1], x[2]))) >> kSubpixelBits); // ceil
+    int64_t maxX = (std::max(x[0], std::max(x[1], x[2])) - half) >> kSubpixelBits;    // floor
+    int64_t minY = -((half - std::min(y[0], std::min(y[1], y[2]))) >> kSubpixelBits);
+    int64_t maxY = (std::max(y[0], std::max(y[1], y[2])) - half) >> kSubpixelBits;
+    minX = std::max<int64_t>(clip.minX, minX);
+    maxX = std::min<int64_t>(clip.maxX, maxX);
+    minY = std::max<int64_t>(clip.minY, minY);
+    maxY = std::min<int64_t>(clip.maxY, maxY);
+    if (!(minX <= maxX && minY <= maxY))
+        return false;
 
-    rasterizer->getViewportHeight();
-    int maxX = std::max(v1.x, std::max(v2.x, v3.x));
-    int minX = std::min(v1.x, std::min(v2.x, v3.x));
-    int maxY = std::max(v1.y, std::max(v2.y, v3.y));
-    int minY = std::min(v1.y, std::min(v2.y, v3.y));
+    bounds = tile{(int)minX, (int)minY, (int)maxX, (int)maxY};
+    return true;
+}
+
+/**
+ * @brief depth test and shade one pixel inside the triangle
+ *
+ * @param e the edge functions at the pixel
+ * @return true if the pixel passed the depth test
+ */
+template <typename Shader, statsLevel Stats, depthFormat Format>
+inline bool shadePixel(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader,
+    depthTest depthTest, const edgeFunctions &edges, int x, int y, const int64_t (&e)[3], rasterizerStats &stats)
+{
+    using count = statsPolicy<Stats>;
+    count::pixel(stats.inside);
 
     // barycentric coordinates
-    float u{0};
-    float v{0};
-    float w{0};
-    barycentricCoordinates bc{};
+    float u = static_cast<float>(e[0]) * edges.invArea;
+    float v = static_cast<float>(e[1]) * edges.invArea;
+    float w = static_cast<float>(e[2]) * edges.invArea;
 
-    // minor optimization: calculate
-    // the constant parts only once
-    bc.prepare(vertices);
+    // z-buffer (depth) check
+    // get the z value for this point using the barymetric coordinates:
+    float z = vertices[0].z * u + vertices[1].z * v + vertices[2].z * w;
 
-    const int width = rasterizer->getViewportWidth();
-    const int height = rasterizer->getViewportHeight();
-    for (int x = minX; x <= maxX; x++)
+    if (depthTest != kLateDepthTest)
     {
-        for (int y = minY; y <= maxY; y++)
+        const bool passed = depthTest == kEqualDepth
+            ? rasterizer->template equalDepth<Format>(x, y, z)
+            : rasterizer->template testDepth<Format>(x, y, z);
+        if (!passed)
         {
+            count::pixel(stats.depth);
+            return false; // occluded, skip the shader
+        }
+        if (depthTest == kDepthOnly)
+            return true;
+        *rasterizer->colorTargetAt(x, y) = fragmentShader(u, v, w, rgba_color);
+        count::pixel(stats.shaded);
+        count::pixel(stats.points);
+        return true;
+    }
+
+    minity::color adjustedColor = fragmentShader(u, v, w, rgba_color);
+    count::pixel(stats.shaded);
+    if (!rasterizer->template testDepth<Format>(x, y, z))
+        return false;
+    *rasterizer->colorTargetAt(x, y) = adjustedColor;
+    count::pixel(stats.points);
+    return true;
+}
+
+/**
+ * @brief walk the pixels of a triangle one at a time
+ *
+ * @param edges prepared edge functions of the triangle
+ * @param depthTest run the fragment shader after (early) or before (late) the depth test
+ * @param area pixels to test (a block of the clipped bounding box)
+ * @param covered the whole area is inside the triangle, skip the edge tests
+ * @return true if any pixel passed the depth test
+ */
+template <typename Shader, statsLevel Stats, depthFormat Format>
+bool fillScalar(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader,
+    depthTest depthTest, const edgeFunctions &edges, const tile &area, bool covered, rasterizerStats &stats)
+{
+    using count = statsPolicy<Stats>;
+    bool drawn{false};
+    int64_t e[3];
 
-            // move the inspection point to the center of the pixel
-            // see: https://www.scratchapixel.com/lessons/3d-basic-rendering/rasterization-practical-implementation/rasterization-stage.html
-            vec3 point  = {static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f, 0}; // IS THIS 0 CORRECT ???
-            // taking the pixel corner produces tears e.g. in sphere:
-            // vec3 point = {static_cast<float>(x), static_cast<float>(y), 0}; // IS THIS 0 CORRECT ???
-            bc.barycentricCoordinatesAt(vertices, point, u, v, w);
+    for (int y = area.minY; y <= area.maxY; y++)
+    {
+        // evaluate the row start and step with (exact) integer adds
+        for (int i : {0, 1, 2})
+            e[i] = edges.at(i, area.minX, y);
 
-            // likely a degenerate triangle (due to rounding the denominator becomes zero)
-            if (!std::isfinite(u) || !std::isfinite(v) || !std::isfinite(w))
+        for (int x = area.minX; x <= area.maxX; x++, e[0] += edges.stepX[0], e[1] += edges.stepX[1], e[2] += edges.stepX[2])
+        {
+            if (!covered && !edges.inside(e))
             {
-                // std::cerr << "WARNING: non-finite barycentric coordinates!!!" << std::endl;
-                // std::cerr << "WARNING: " << u << " " << v << " " << w << std::endl;
-                rasterizer->stats.degenerate++;
-                continue;
+                count::pixel(stats.outside);
+                continue; // we're outside the triangle
             }
+            drawn |= shadePixel<Shader, Stats, Format>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, x, y, e, stats);
+        }
+    }
+    return drawn;
+}
+
+/**
+ * @brief walk the pixels of a triangle kSimdLanes at a time
+ *
+ * Coverage, depth interpolation and the depth compare-and-store are done
+ * for all lanes at once. With the early depth test the fragment shader runs
+ * only for the lanes that are inside the triangle and pass the depth test.
+ *
+ * @param edges prepared edge functions of the triangle
+ * @param depthTest run the fragment shader after (early) or before (late) the depth test
+ * @param area pixels to test (a block of the clipped bounding box)
+ * @param covered the whole area is inside the triangle, skip the edge tests
+ * @return true if any pixel passed the depth test
+ */
+template <typename Shader, statsLevel Stats, depthFormat Format>
+bool fillSimd(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader,
+    depthTest depthTest, const edgeFunctions &edges, const tile &area, bool covered, rasterizerStats &stats)
+{
+    using count = statsPolicy<Stats>;
+    bool anyDrawn{false};
+    longv offsets{}; // {0, 1, 2, ...}
+    for (int l = 0; l < kSimdLanes; ++l)
+        offsets[l] = l;
+    longv laneStart[3]; // E of each lane relative to the first lane
+    longv step[3];
+    longv bias[3];
+    for (int i : {0, 1, 2})
+    {
+        laneStart[i] = (longv{} + edges.stepX[i]) * offsets;
+        step[i] = longv{} + edges.stepX[i] * kSimdLanes;
+        bias[i] = longv{} + edges.bias[i];
+    }
+    const floatv invArea = splat(edges.invArea);
+
+    longv e[3];
+    for (int y = area.minY; y <= area.maxY; y++)
+    {
+        for (int i : {0, 1, 2})
+            e[i] = (longv{} + edges.at(i, area.minX, y)) + laneStart[i];
+
+        color *frame = rasterizer->colorTargetAt(area.minX, y);
+        typename depthTraits<Format>::type *depth = rasterizer->template depthBufferAt<Format>(area.minX, y);
+        for (int x = area.minX; x <= area.maxX; x += kSimdLanes, frame += kSimdLanes, depth += kSimdLanes)
+        {
+            const int lanes = std::min(kSimdLanes, area.maxX - x + 1);
+            const intv inRow = lanes == kSimdLanes ? kAllLanes : firstLanes(lanes);
 
-            if (u < 0 || v < 0 || w < 0)
+            // same as edgeFunctions::inside for every lane
+            intv inside = inRow;
+            if (!covered)
+                inside &= __builtin_convertvector(((e[0] + bias[0]) | (e[1] + bias[1]) | (e[2] + bias[2])) >= 0, intv);
+
+            if (!anyLane(inside))
             {
-                rasterizer->stats.outside++;
+                count::pixel(stats.outside, lanes);
+                for (int i : {0, 1, 2})
+                    e[i] += step[i];
                 continue; // we're outside the triangle
             }
-            rasterizer->stats.inside++;
+            const int insideCount = Stats >= kPixelStats ? countLanes(inside) : 0;
+            count::pixel(stats.outside, lanes - insideCount);
+            count::pixel(stats.inside, insideCount);
+
+            floatv u = __builtin_convertvector(e[0], floatv) * invArea;
+            floatv v = __builtin_convertvector(e[1], floatv) * invArea;
+            floatv w = __builtin_convertvector(e[2], floatv) * invArea;
+            floatv z = splat(vertices[0].z) * u + splat(vertices[1].z) * v + splat(vertices[2].z) * w;
+
+            // vectorized z-check, write the depth of the passing lanes
+            const auto storedDepth = depthTraits<Format>::load(depth, lanes);
+            const auto encodedDepth = depthTraits<Format>::encode(z);
+            intv passed = inside;
+            if (depthTest == kEqualDepth)
+                passed &= encodedDepth == storedDepth;
+            else
+            {
+                passed &= depthTraits<Format>::passes(encodedDepth, storedDepth);
+                depthTraits<Format>::store(depth, select(passed, encodedDepth, storedDepth), lanes);
+            }
+
+            const bool drawn = anyLane(passed);
+            anyDrawn |= drawn;
+            const int drawnCount = Stats >= kPixelStats ? countLanes(passed) : 0;
+            if (depthTest == kDepthOnly)
+            {
+                count::pixel(stats.depth, insideCount - drawnCount);
+                for (int i : {0, 1, 2})
+                    e[i] += step[i];
+                continue; // no shader and no color
+            }
+            count::pixel(stats.points, drawnCount);
+
+            // the shader is called per lane
+            float lu[kSimdLanes];
+            float lv[kSimdLanes];
+            float lw[kSimdLanes];
+            int32_t lanePassed[kSimdLanes];
+            storeLanes(lu, u);
+            storeLanes(lv, v);
+            storeLanes(lw, w);
+            storeLanes(lanePassed, passed);
+            if (depthTest != kLateDepthTest)
+            {
+                // shade only the surviving lanes
+                count::pixel(stats.depth, insideCount - drawnCount);
+                count::pixel(stats.shaded, drawnCount);
+                for (int l = 0; drawn && l < lanes; ++l)
+                    if (lanePassed[l])
+                        frame[l] = fragmentShader(lu[l], lv[l], lw[l], rgba_color);
+            }
+            else
+            {
+                // shade all covered lanes, keep the ones that passed
+                int32_t laneInside[kSimdLanes];
+                storeLanes(laneInside, inside);
+                count::pixel(stats.shaded, insideCount);
+                for (int l = 0; l < lanes; ++l)
+                {
+                    if (!laneInside[l])
+                        continue;
+                    minity::color adjustedColor = fragmentShader(lu[l], lv[l], lw[l], rgba_color);
+                    if (lanePassed[l])
+                        frame[l] = adjustedColor;
+                }
+            }
+
+            for (int i : {0, 1, 2})
+                e[i] += step[i];
+        }
+    }
+    return anyDrawn;
+}
+
+/**
+ * @brief fast path of triangles with a bounding box within Size x Size pixels
+ *
+ * Dense meshes are mostly made of triangles covering a few pixels, for
+ * them the block classification, the hierarchical z test and the block
+ * depth update cost more than the pixels. The Size x Size samples are
+ * tested directly in fully unrolled loops instead. The block depth is not
+ * updated (it stays valid as depth only gets nearer).
+ *
+ * @param bounds bounding box of the triangle clipped to the viewport or tile
+ * @tparam Size 2 or 4, the bounding box is at most Size x Size pixels
+ */
+template <typename Shader, statsLevel Stats, depthFormat Format, int Size>
+void fillSmall(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader,
+    depthTest depthTest, const edgeFunctions &edges, const tile &bounds, rasterizerStats &stats)
+{
+    // at most the four blocks of the corners
+    rasterizer->touchBlock(bounds.minX, bounds.minY);
+    rasterizer->touchBlock(bounds.maxX, bounds.minY);
+    rasterizer->touchBlock(bounds.minX, bounds.maxY);
+    rasterizer->touchBlock(bounds.maxX, bounds.maxY);
+
+    int64_t row[3];
+    for (int i : {0, 1, 2})
+        row[i] = edges.at(i, bounds.minX, bounds.minY);
+    for (int dy = 0; dy < Size; dy++)
+    {
+        const int y = bounds.minY + dy;
+        int64_t e[3]{row[0], row[1], row[2]};
+        for (int dx = 0; dx < Size; dx++)
+        {
+            const int x = bounds.minX + dx;
+            if (x <= bounds.maxX && y <= bounds.maxY)
+            {
+                if (edges.inside(e))
+                    shadePixel<Shader, Stats, Format>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, x, y, e, stats);
+                else
+                    statsPolicy<Stats>::pixel(stats.outside);
+            }
+            for (int i : {0, 1, 2})
+                e[i] += edges.stepX[i];
+        }
+        for (int i : {0, 1, 2})
+            row[i] += edges.b[i] * kSubpixelScale;
+    }
+}
+
+/**
+ * @brief walk the rows of a triangle and fill the covered span of each row
+ *
+ * The spans are solved from the same edge functions as the block walk,
+ * so exactly the same pixels are covered, but there is no inside test per
+ * pixel and no walk over the empty parts of the bounding box. Depth and the
+ * barycentric coordinates start exact at the span and are then stepped with
+ * one add per pixel. The hierarchical z is not used (and stays valid as
+ * depth only gets nearer).
+ *
+ * @param edges prepared edge functions of the triangle
+ * @param depthTest run the fragment shader after (early) or before (late) the depth test
+ * @param bounds bounding box of the triangle clipped to the viewport or tile
+ */
+template <typename Shader, statsLevel Stats, depthFormat Format>
+void fillScanline(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader,
+    depthTest depthTest, const edgeFunctions &edges, const tile &bounds, rasterizerStats &stats)
+{
+    using count = statsPolicy<Stats>;
+    // everything is linear in screen space, so the steps are constant
+    const float du = static_cast<float>(edges.stepX[0]) * edges.invArea;
+    const float dv = static_cast<float>(edges.stepX[1]) * edges.invArea;
+    const float dw = static_cast<float>(edges.stepX[2]) * edges.invArea;
+    const float dz = vertices[0].z * du + vertices[1].z * dv + vertices[2].z * dw;
+
+    int first{0};
+    int last{0};
+    for (int y = bounds.minY; y <= bounds.maxY; y++)
+    {
+        if (!edges.span(y, bounds.minX, bounds.maxX, first, last))
+            continue;
+        count::pixel(stats.inside, last - first + 1);
+        for (int blockX = first / kBlockSize; blockX <= last / kBlockSize; blockX++)
+            rasterizer->touchBlock(blockX * kBlockSize, y);
+
+        float u, v, w;
+        edges.barycentricAt(first, y, u, v, w);
+        float z = vertices[0].z * u + vertices[1].z * v + vertices[2].z * w;
+        for (int x = first; x <= last; x++, u += du, v += dv, w += dw, z += dz)
+        {
+            if (depthTest != kLateDepthTest)
+            {
+                const bool passed = depthTest == kEqualDepth
+                    ? rasterizer->template equalDepth<Format>(x, y, z)
+                    : rasterizer->template testDepth<Format>(x, y, z);
+                if (!passed)
+                {
+                    count::pixel(stats.depth);
+                    continue; // occluded, skip the shader
+                }
+                if (depthTest == kDepthOnly)
+                    continue;
+                // copies, the shader takes the coordinates by reference
+                float su{u}, sv{v}, sw{w};
+                *rasterizer->colorTargetAt(x, y) = fragmentShader(su, sv, sw, rgba_color);
+                count::pixel(stats.shaded);
+                count::pixel(stats.points);
+            }
+            else
+            {
+                float su{u}, sv{v}, sw{w};
+                minity::color adjustedColor = fragmentShader(su, sv, sw, rgba_color);
+                count::pixel(stats.shaded);
+                if (rasterizer->template testDepth<Format>(x, y, z))
+                {
+                    *rasterizer->colorTargetAt(x, y) = adjustedColor;
+                    count::pixel(stats.points);
+                }
+            }
+        }
+    }
+}
+
+/**
+ * @brief walk the bounding box of a triangle in blocks
+ *
+ * Blocks outside the triangle are skipped, fully covered blocks are filled
+ * without edge tests and only the partially covered blocks on the
+ * triangle edges are tested pixel by pixel. Blocks whose nearest depth
+ * is behind everything already drawn in them are skipped as well, except
+ * for kLateDepthTest where the shader sees every covered fragment.
+ *
+ * @param edges prepared edge functions of the triangle
+ * @param bounds bounding box of the triangle clipped to the viewport or tile
+ * @tparam Format depth format of the rasterizer
+ */
+template <typename Shader, statsLevel Stats, depthFormat Format>
+void fillBlocks(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader,
+    depthTest depthTest, const edgeFunctions &edges, const tile &bounds, rasterizerStats &stats)
+{
+    typedef depthTraits<Format> traits;
+    const bool simd = rasterizer->getFillMode() == kSimd;
+
+    // depth is linear in screen space: z = (z0 * E0 + z1 * E1 + z2 * E2) / area,
+    // so its nearest value over a block is at one of the corners (and it's never
+    // nearer than the nearest vertex). Rounding of the per pixel z can still end
+    // up a tiny bit nearer, so the block test is kept conservative. The depth
+    // keys are smaller for nearer z in every format.
+    const float kBlockDepthTolerance{1e-5f};
+    const float tolerance = kBlockDepthTolerance * std::max(std::fabs(vertices[0].z), std::max(std::fabs(vertices[1].z), std::fabs(vertices[2].z)));
+    const float nearestVertex = std::min(traits::key(vertices[0].z), std::min(traits::key(vertices[1].z), traits::key(vertices[2].z)));
+    auto depthAt = [&](int x, int y) {
+        float u, v, w;
+        edges.barycentricAt(x, y, u, v, w);
+        return traits::key(vertices[0].z * u + vertices[1].z * v + vertices[2].z * w);
+    };
+
+    // blocks are aligned to the block grid, the first and the last
+    // ones of each row and column are cut to the bounding box
+    const int firstX = bounds.minX - bounds.minX % kBlockSize;
+    const int firstY = bounds.minY - bounds.minY % kBlockSize;
+    for (int blockY = firstY; blockY <= bounds.maxY; blockY += kBlockSize)
+    {
+        for (int blockX = firstX; blockX <= bounds.maxX; blockX += kBlockSize)
+        {
+            tile block{
+                std::max(blockX, bounds.minX),
+                std::max(blockY, bounds.minY),
+                std::min(blockX + kBlockSize - 1, bounds.maxX),
+                std::min(blockY + kBlockSize - 1, bounds.maxY)};
+
+            edgeFunctions::coverage coverage = edges.blockCoverage(block);
+            if (coverage == edgeFunctions::kNone)
+            {
+                statsPolicy<Stats>::frame(stats.blocksRejected);
+                continue;
+            }
 
-            // clipping #3 to viewport/projection space
-            if (x < 0 || x >= width || y < 0 || y >= height)
+            const float nearest = std::max(nearestVertex,
+                std::min(std::min(depthAt(block.minX, block.minY), depthAt(block.maxX, block.minY)),
+                    std::min(depthAt(block.minX, block.maxY), depthAt(block.maxX, block.maxY))));
+            if (depthTest != kLateDepthTest && nearest - tolerance > rasterizer->blockDepthAt(block.minX, block.minY))
             {
-                rasterizer->stats.xyClipped++;
-                continue; // we're outside the viewport
+                statsPolicy<Stats>::frame(stats.blocksDepthRejected);
+                continue;
             }
 
-            // z-buffer (depth) check
-            // get the z value for this point using the barymetric coordinates:
-            float z = v1.z * u + v2.z * v + v3.z * w;
+            rasterizer->touchBlock(block.minX, block.minY);
+            const bool covered = coverage == edgeFunctions::kFull;
+            if (covered)
+                statsPolicy<Stats>::frame(stats.blocksAccepted);
+            else
+                statsPolicy<Stats>::frame(stats.blocksPartial);
+
+            const bool drawn = simd
+                ? fillSimd<Shader, Stats, Format>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, block, covered, stats)
+                : fillScalar<Shader, Stats, Format>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, block, covered, stats);
+            if (drawn && depthTest != kEqualDepth) // the equal test doesn't change the depth
+                rasterizer->template updateBlockDepth<Format>(block.minX, block.minY);
+        }
+    }
+}
+
+/**
+ * @brief fill a triangle in the unordered mode
+ *
+ * Any thread may draw to any pixel, so a fragment updates the packed
+ * word of its pixel (see packPixel) with a compare-exchange loop and the
+ * nearest fragment wins in any order. The fragments behind the stored
+ * depth skip the shader (unless kLateDepthTest), the stored depth only
+ * gets nearer. The spans are walked like fillScanline.
+ *
+ * @param depthTest kLateDepthTest shades the occluded fragments as well,
+ *        kDepthOnly keeps the stored color and kEqualDepth replaces the
+ *        color of an equal depth
+ */
+template <typename Shader, statsLevel Stats, depthFormat Format>
+void fillPacked(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader,
+    depthTest depthTest, const edgeFunctions &edges, const tile &bounds, rasterizerStats &stats)
+{
+    typedef depthTraits<Format> traits;
+    using count = statsPolicy<Stats>;
+    const float du = static_cast<float>(edges.stepX[0]) * edges.invArea;
+    const float dv = static_cast<float>(edges.stepX[1]) * edges.invArea;
+    const float dw = static_cast<float>(edges.stepX[2]) * edges.invArea;
+    const float dz = vertices[0].z * du + vertices[1].z * dv + vertices[2].z * dw;
 
-            minity::color adjustedColor = fragmentShader(u, v, w, rgba_color);
+    int first{0};
+    int last{0};
+    for (int y = bounds.minY; y <= bounds.maxY; y++)
+    {
+        if (!edges.span(y, bounds.minX, bounds.maxX, first, last))
+            continue;
+        count::pixel(stats.inside, last - first + 1);
 
-            rasterizer->drawPoint(vec3{(float)x, (float)y, z}, adjustedColor);
+        float u, v, w;
+        edges.barycentricAt(first, y, u, v, w);
+        float z = vertices[0].z * u + vertices[1].z * v + vertices[2].z * w;
+        for (int x = first; x <= last; x++, u += du, v += dv, w += dw, z += dz)
+        {
+            const u_int64_t depth = packPixel(traits::ordered(traits::encode(z)), 0);
+            std::atomic<u_int64_t> &pixel = rasterizer->packedAt(x, y);
+            u_int64_t stored = pixel.load(std::memory_order_relaxed);
+            if (depthTest != kLateDepthTest && (depthTest == kEqualDepth ? depth != (stored & kPackedDepth) : depth > (stored & kPackedDepth)))
+            {
+                count::pixel(stats.depth);
+                continue; // occluded, skip the shader
+            }
+
+            color fragment{0};
+            if (depthTest != kDepthOnly)
+            {
+                float su{u}, sv{v}, sw{w};
+                fragment = fragmentShader(su, sv, sw, rgba_color);
+                count::pixel(stats.shaded);
+            }
+            // stored is reloaded by every failed exchange
+            bool written{false};
+            while (!written)
+            {
+                if (depthTest == kEqualDepth)
+                {
+                    if (depth != (stored & kPackedDepth))
+                        break;
+                    written = pixel.compare_exchange_weak(stored, depth | fragment, std::memory_order_relaxed);
+                }
+                else
+                {
+                    const u_int64_t nearer = depthTest == kDepthOnly ? depth | (stored & ~kPackedDepth) : depth | fragment;
+                    if (nearer >= stored)
+                        break;
+                    written = pixel.compare_exchange_weak(stored, nearer, std::memory_order_relaxed);
+                }
+            }
+            if (!written)
+                count::pixel(stats.depth);
+            else if (depthTest != kDepthOnly)
+                count::pixel(stats.points);
         }
     }
 }
 
+// the small triangle fast paths, otherwise scanlines or blocks
+// (scalar or simd) depending on the fill mode, packed pixels in the
+// unordered mode
+template <typename Shader, statsLevel Stats, depthFormat Format>
+void fillTriangle(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader,
+    depthTest depthTest, const edgeFunctions &edges, const tile &bounds, rasterizerStats &stats)
+{
+    if (rasterizer->isUnordered())
+    {
+        fillPacked<Shader, Stats, Format>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+        return;
+    }
+
+    // classified by the whole triangle, not the part in the tile, so that
+    // binning takes the same paths: an extent below Size (after snapping)
+    // contains at most Size pixel centers
+    const float extent = std::max(
+        std::max(vertices[0].x, std::max(vertices[1].x, vertices[2].x)) - std::min(vertices[0].x, std::min(vertices[1].x, vertices[2].x)),
+        std::max(vertices[0].y, std::max(vertices[1].y, vertices[2].y)) - std::min(vertices[0].y, std::min(vertices[1].y, vertices[2].y)));
+    const float snapping = 1.0f / kSubpixelScale;
+    if (extent < 2.0f - snapping)
+    {
+        statsPolicy<Stats>::frame(stats.tiny);
+        fillSmall<Shader, Stats, Format, 2>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+    }
+    else if (extent < 4.0f - snapping)
+    {
+        statsPolicy<Stats>::frame(stats.small);
+        fillSmall<Shader, Stats, Format, 4>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+    }
+    else if (rasterizer->getFillMode() == kScanline)
+        fillScanline<Shader, Stats, Format>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+    else
+        fillBlocks<Shader, Stats, Format>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+}
+
+/**
+ * @brief draw triangle to framebuffer
+ *
+ * @param vertices vec3[3] of triangle vertices in screen space
+ * @param rgba_color minity::color with 0xrrggbbaa format
+ * @param rasterizer pointer to the rasterizer instance to use (facilitate easier testing)
+ * @param fragmentShader called with the barycentric coordinates of each covered pixel
+ * @param depthTest kEarlyDepthTest calls the shader only for pixels passing the depth test,
+ *        see depthTest for the depth prepass
+ * @param clip only pixels within this area are drawn (viewport or a tile)
+ * @param stats statistics of the viewport or the tile
+ * @tparam Stats counters collected in stats, see statsLevel
+ */
+template <typename Shader, statsLevel Stats>
+void plotTriangle(const vec3 (&vertices)[3], const color rgba_color, rasterizer *rasterizer, const Shader &fragmentShader, depthTest depthTest, const tile &clip, rasterizerStats &stats)
+{
+    tile bounds{};
+    if (!triangleBounds(vertices, clip, bounds))
+    {
+        // e.g. sub-pixel triangles between the pixel centers
+        statsPolicy<Stats>::frame(stats.culled);
+        return;
+    }
+
+    // triangle setup: calculate the constant parts only once
+    edgeFunctions edges{};
+    if (!edges.prepare(vertices))
+    {
+        // degenerate triangle (zero area after snapping to the sub-pixel grid)
+        statsPolicy<Stats>::frame(stats.degenerate);
+        return;
+    }
+
+    // the fill loops are compiled for every depth format
+    switch (rasterizer->getDepthFormat())
+    {
+    case kDepthReversedFloat:
+        fillTriangle<Shader, Stats, kDepthReversedFloat>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+        break;
+    case kDepthUnorm24:
+        fillTriangle<Shader, Stats, kDepthUnorm24>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+        break;
+    case kDepthUnorm16:
+        fillTriangle<Shader, Stats, kDepthUnorm16>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+        break;
+    default:
+        fillTriangle<Shader, Stats, kDepthFloat>(vertices, rgba_color, rasterizer, fragmentShader, depthTest, edges, bounds, stats);
+    }
+}
+
 } // NS minity
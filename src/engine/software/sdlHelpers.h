@@ -196,6 +196,7 @@ void SDLClearBuffers()
 void SDLSwapBuffers(minity::rasterizer &rasterizer)
 {
     // SDL_UpdateTexture(g_SDLTexture, NULL, g_SDLBackBuffer, g_SDLWidth * sizeof(Uint32));
+    // getFramebuffer resolves the tiled layout to a linear image if needed
     SDL_UpdateTexture(
         g_SDLTexture,
         NULL,
@@ -0,0 +1,95 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+namespace minity
+{
+
+// Portable SIMD vectors with the gcc/clang vector extensions.
+// The compiler maps them to SSE2 (or AVX2 with -mavx2) on x86
+// and to NEON on arm64, so there are no intrinsics to maintain.
+// SEE: https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
+// SEE: https://clang.llvm.org/docs/LanguageExtensions.html#vectors-and-extended-vectors
+
+#if defined(__AVX2__)
+const int kSimdLanes{8};
+#else
+const int kSimdLanes{4};
+#endif
+
+typedef float floatv __attribute__((vector_size(kSimdLanes * sizeof(float))));
+typedef int32_t intv __attribute__((vector_size(kSimdLanes * sizeof(int32_t))));
+// 64 bit lanes (edge functions) are wider than a SSE register, gcc warns
+// (-Wpsabi) about functions passing them, so they are only used as locals
+// and converted with __builtin_convertvector
+typedef int64_t longv __attribute__((vector_size(kSimdLanes * sizeof(int64_t))));
+
+// comparisons return lane masks: all bits set (-1) for true, 0 for false
+const intv kAllLanes = intv{} - 1;
+
+inline floatv splat(float value)
+{
+    return floatv{} + value;
+}
+
+
+// lanes [0, count) set
+inline intv firstLanes(int count)
+{
+    intv mask{};
+    for (int i = 0; i < kSimdLanes; ++i)
+        mask[i] = i < count ? -1 : 0;
+    return mask;
+}
+
+// a where mask is set, otherwise b
+inline floatv select(intv mask, floatv a, floatv b)
+{
+    return (floatv)((mask & (intv)a) | (~mask & (intv)b));
+}
+
+inline intv select(intv mask, intv a, intv b)
+{
+    return (mask & a) | (~mask & b);
+}
+
+inline bool anyLane(intv mask)
+{
+    for (int i = 0; i < kSimdLanes; ++i)
+        if (mask[i])
+            return true;
+    return false;
+}
+
+inline int countLanes(intv mask)
+{
+    int count{0};
+    for (int i = 0; i < kSimdLanes; ++i)
+        count += mask[i] & 1;
+    return count;
+}
+
+// unaligned loads and stores of the first count lanes,
+// so that rows do not need padding to full vectors
+template <typename V, typename T>
+inline V loadLanes(const T *data, int count = kSimdLanes)
+{
+    V v{};
+    if (count == kSimdLanes)
+        std::memcpy(&v, data, sizeof(V));
+    else
+        std::memcpy(&v, data, count * sizeof(T));
+    return v;
+}
+
+template <typename V, typename T>
+inline void storeLanes(T *data, V v, int count = kSimdLanes)
+{
+    if (count == kSimdLanes)
+        std::memcpy(data, &v, sizeof(V));
+    else
+        std::memcpy(data, &v, count * sizeof(T));
+}
+
+} // NS minity
@@ -7,6 +7,7 @@
 #include "../../simpleMath.h"
 #include "../frameTimer.h"
 #include "sdlHelpers.h"
+#include "clipper.h"
 #include "rasterizer.h"
 #include "stats.h"
 
@@ -38,189 +39,182 @@ softwareEngine::softwareEngine() : m_input(input::instance())
     SDLClearBuffers();
 };
 
-enum spaceType
+// output of the vertex stage, entry i of every array is mesh.vertexData[i]
+struct transformedVertices
 {
-    // localSpace
-    worldSpace = 0,
-    viewSpace = 1,
-    clipSpace = 2,
-    ndcCoordinates = 3,
-    screenSpace = 4
+    vec3SoA view; // view space positions (back face culling, flat shading)
+    vec3SoA clip; // clip space positions (clipping, w for the perspective correction)
+    vec3SoA screen; // screen space positions for the rasterizer
+    vec3SoA normal; // view space normals
+};
+
+// the matrices of the vertex stage, set up once per frame
+struct vertexTransforms
+{
+    mat4 modelMatrix;
+    mat4 viewMatrix;
+    mat4 projectionMatrix;
+    // https://gamedev.stackexchange.com/questions/68387/how-to-modify-normal-vectors-with-a-tranformation-matrix
+    mat4 normalModelMatrix; // transposeMat4(inverseModelMatrix)
+    mat4 normalViewMatrix; // transposeMat4(inverseViewMatrix)
 };
 
 // ~vertex shader function
-// calculates vertices all the way to screen space (typically only to clip space)
-// TODO: make matrices come from model getters
-// TODO: figure out if we need to add some encapsulation for vects/norms/texc
-// TODO: we don't need the intermediate steps, so combine transforms like in metal shader
-// NOTE: normals and texture coordinates are converted even if missing
-void processVertices(
-    minity::model &model,
-    const int faceIndex, const int idx,
-    vec3 (&vects)[5][3], vec3 (&norms)[5][3], vec2 (&texc)[3],
-    const mat4 &modelMatrix, const mat4 &viewMatrix, const mat4 &projectionMatrix,
-    const mat4 &inverseModelMatrix, const mat4 &inverseViewMatrix, const mat4 &inverseProjectionMatrix,
-    renderStats &stats)
+// calculates all vertices of a mesh all the way to screen space (typically
+// only to clip space) with the batch transforms of simpleMath.h
+// NOTE: normals are converted even if missing, texture coordinates
+// don't change with transformations and are read from the mesh
+void processVertices(const minity::mesh &mesh, transformedVertices &out, const vertexTransforms &transforms, renderStats &stats)
 {
-    stats.vertices++;
+    const size_t count = mesh.vertexData.size();
+    stats.shadedVertices += count;
+    if (count == 0)
+        return;
 
     // Here triangles are still in MODEL/LOCAL SPACE
     // i.e. coordinates coming from the modeling software (and .obj file)
-
-    auto modelIndex = model.mesh.indexData[faceIndex * 3 + idx];
-
-    vects[worldSpace][idx % 3] = multiplyVec3(model.mesh.vertexData[modelIndex].position, modelMatrix);
-    // https://gamedev.stackexchange.com/questions/68387/how-to-modify-normal-vectors-with-a-tranformation-matrix
-    auto mn = model.mesh.vertexData[modelIndex].normal;
-    mn.w = 0;
-    norms[worldSpace][idx % 3] = multiplyVec3(mn, transposeMat4(inverseModelMatrix));
-
-    // texture coordinates don't change with transformations
-    texc[idx % 3] = model.mesh.vertexData[modelIndex].texcoord;
-
-    // Here triangles are in WORLD SPACE
-    // i.e. common coordinates for all models in scene
-    // only camera, no projection
-
-    vects[viewSpace][idx % 3] = multiplyVec3(vects[worldSpace][idx % 3], viewMatrix);
-    // https://gamedev.stackexchange.com/questions/68387/how-to-modify-normal-vectors-with-a-tranformation-matrix
-    norms[viewSpace][idx % 3] = multiplyVec3(norms[worldSpace][idx % 3], transposeMat4(inverseViewMatrix));
-
-    // Here triangles are in VIEW SPACE
-    // i.e. coordinates looking from camera
-    // so a point at world space camera coordinates is (0,0,0)
-
-    vects[clipSpace][idx % 3] = multiplyVec3(vects[viewSpace][idx % 3], projectionMatrix);
-    // https://gamedev.stackexchange.com/questions/68387/how-to-modify-normal-vectors-with-a-tranformation-matrix
-    norms[clipSpace][idx % 3] = multiplyVec3(norms[viewSpace][idx % 3], transposeMat4(inverseProjectionMatrix));
-
-    // Here triangles are in CLIP SPACE in homogeneous coordinates
+    // The model (to WORLD SPACE), view (to VIEW SPACE, looking from the
+    // camera) and projection (to CLIP SPACE) are combined to one matrix
+    // each, as only the view and the screen positions are needed.
+
+    const mat4 modelViewMatrix = multiplyMat4(transforms.viewMatrix, transforms.modelMatrix);
+    const vec3 *positions = &mesh.vertexData[0].position;
+    transformPositions(positions, count, sizeof(minity::vertexData), modelViewMatrix, out.view);
+
+    // the translations of the normal matrices only end up in w,
+    // so the normals don't need w = 0 for the x, y, z
+    const mat4 normalMatrix = multiplyMat4(transforms.normalViewMatrix, transforms.normalModelMatrix);
+    transformPositions(&mesh.vertexData[0].normal, count, sizeof(minity::vertexData), normalMatrix, out.normal);
+
+    // CLIP SPACE in homogeneous coordinates is divided by w (NDC SPACE,
+    // x, y, z in [-1,1]) and mapped to SCREEN SPACE in the same pass:
+    // (0,0) is top-left, (x=-1, y=1) -> (0, 0), (x=1, y=-1) -> (sWidth, sHeight)
+    // and z is retained as -1 .. 1 for z-buffering
     // https://en.wikipedia.org/wiki/Homogeneous_coordinates
-
-    // TODO: maybe we should move the ndc and screen conversion to the rasterizer
-    // as that would align better with the normal rendering pipeline where
-    // the vertex shader moves vertices from model to clip space?
-
-    // normalise into cartesian space
-    vec3 vClip = vects[clipSpace][idx % 3];
-    vects[ndcCoordinates][idx % 3] = v3Div(vClip, vClip.w);
-    vec3 nClip = norms[clipSpace][idx % 3]; // ???
-    norms[ndcCoordinates][idx % 3] = v3Div(nClip, nClip.w); // ???
-
-    // Here triangles are in NDC SPACE x, y, z in [-1,1]
-
-    // move all vertices to screen space for rasterization
-    // Assumes -1 .. +1 box
-    // Screen coordinates: (0,0) is top-left!
-    // (x=-1, y=1) -> (0, 0)
-    // (x=-1, y=-1) -> (0, sHeight)
-    // (x=1, y=1) -> (sWidth, 0)
-    // (x=1, y=-1) -> (sWidth, sHeight)
-    // z=-1 -> 0 and z=1 -> 1
-
-    vec3 v = vects[ndcCoordinates][idx % 3];
-    v.x = (v.x + 1.0f) * static_cast<float>(g_SDLWidth) / 2.0f;
-    v.y = (1.0f - ((v.y + 1.0f) / 2.0f)) * static_cast<float>(g_SDLHeight);
-    // z is retained as -1 .. 1 for z-buffering
-    vects[screenSpace][idx % 3] = v;
+    const mat4 modelViewProjectionMatrix = multiplyMat4(transforms.projectionMatrix, modelViewMatrix);
+    projectPositions(positions, count, sizeof(minity::vertexData), modelViewProjectionMatrix,
+                     static_cast<float>(g_SDLWidth), static_cast<float>(g_SDLHeight), out.clip, out.screen);
 
     // we don't need normals in screenspace as lighting is done in view space
-    // norms[screenSpace][idx % 3] = multiplyVec3(norms[clipSpace][idx % 3], viewMatrix);
+};
 
-    // Here triangles are all in screen space (0,0) -> (screenWidth, screenHeight)
+// vertex attributes interpolated for the fragment shader
+enum faceAttribute
+{
+    kTextureU,
+    kTextureV,
+    kNormalX, // view space vertex normal
+    kNormalY,
+    kNormalZ,
+    kFaceAttributes
 };
 
 /**
- * @brief clip a triangle to within the clip-space volume
- *
- * TODO: add new faces if clipped (and adjust the return value)
+ * @brief per face inputs of the fragment shader
  *
- * @param ndcVertices
- * @param stats
- * @return true if the entire triangle is within the clip-space volume
- * @return false if there are any vertices outside the clip-space volume
+ * Copied into the shader by value, as the binned rasterizer
+ * runs the shader after the face is gone.
  */
-bool clippingFunction(vec3 (&ndcVertices)[3], renderStats &stats)
+struct faceShaderInputs
 {
-    // CLIPPING faces to within the clip-space volume
-    int numFacesOutside = 0;
-    for (auto &v : ndcVertices) // vects[ndcCoordinates])
-    {
-        if (!(v.x >= -1 && v.x <= 1
-            && v.y >= -1 && v.y <= 1
-            && v.z >= -1 && v.z <= 1))
-        {
-        // std::cout << "vertex outside view frustrum: " << v.str() << std::endl;
-        numFacesOutside += 1;
-        }
-    }
-    switch (numFacesOutside)
-    {
-    case 3:
-        // if all vertices are outside, this triangle can be discarded
-        // std::cout << "CLIPPING - discarding face, 3 outside " << vects[ndcCoordinates][0].str() << " " << vects[ndcCoordinates][1].str() << " " << vects[ndcCoordinates][2].str() << std::endl;
-        stats.vfCulled++;
-        return false;
-    case 2:
-        // TODO: bring the 2 vertices that are outside to screen border
-        // std::cout << "CLIPPING - discarding face, 2 outside " << vects[ndcCoordinates][0].str() << " " << vects[ndcCoordinates][1].str() << " " << vects[ndcCoordinates][2].str() << std::endl;
-        stats.vfCulled++;
-        return false;
-    case 1:
-        // TODO: split the base into 2 triangles and change the new vertices to screen border
-        // std::cout << "CLIPPING - discarding face, 1 outside " << vects[ndcCoordinates][0].str() << " " << vects[ndcCoordinates][1].str() << " " << vects[ndcCoordinates][2].str() << std::endl;
-        stats.vfCulled++;
-        return false;
-    case 0:
-        // face fully within frustrum - render normally
-        break;
-    default:
-        std::cerr << "unknown number of faces putside camera frustrum " << numFacesOutside << " - exiting" << std::endl;
-        exit(1);
-        break;
-    }
-
-    assert(numFacesOutside <= 1);
-    return true;
+    const minity::texture *texture;
+    varyings<kFaceAttributes> attributes; // set up once per face
+    vec3 lightDirection;
 };
 
 /**
- * @brief back face culling
+ * @brief fragment shader permutations of the software renderer
+ *
+ * Texturing and lighting are template parameters, so every permutation
+ * (flat, textured, lit, textured and lit) is compiled without per pixel
+ * checks and the rasterizer inlines it into the fill loop.
  *
- * @param viewVertices
- * @param stats
- * @return true if face is forwardfacing and should be drawn
- * @return false if face is backwardfacing and should be culled
+ * @tparam textured model has a texture and texture coordinates
+ * @tparam lit model has vertex normals (otherwise the face color is flat shaded)
  */
-bool cullingFunction(vec3 (&viewVertices)[3], renderStats &stats)
+template <bool textured, bool lit>
+struct modelShader
 {
-        // SEE: https://en.wikipedia.org/wiki/Back-face_culling
-        // This is view space culling, we can also do (NDC) clip space culling later
+    faceShaderInputs face;
 
-        // back-face culling - polygons that face away from the camera can be culled
-        // we do it in view space (=camera coordinates)
-        // cannot do it in world space as we have to anyway adjust for possible camera rotation
-
-        // faces are in clockwise winding order
-        // i.e. left-hand rule (thumb faces front)
-        // (center > up > right faces front)
+    minity::color operator()(float &u, float &v, float &w, minity::color color) const
+    {
+        return shade(face, u, v, w, color);
+    }
 
-        // cross-product a x b follows right-hand rule
-        // i.e. a = v2 - v0 and b = v1 - v0
-        // so that the normal points front
-        vec3 faceNormal = v3Normalize(v3CrossProduct(
-            v3Sub(viewVertices[2], viewVertices[0]),
-            v3Sub(viewVertices[1], viewVertices[0])));
+    static minity::color shade(const faceShaderInputs &face, float u, float v, float w, minity::color color)
+    {
+        auto adjustedColor = color; // material color if no texture
 
-        auto vCameraRay = v3Normalize(v3Sub(vec3{0}, viewVertices[0])); // in view space camera is at origin, so pick one vertice and calculate direction towards it
-        auto faceDotCamera = v3DotProduct(faceNormal, vCameraRay);
+        // perspective correct attributes, see varyings
+        const varyings<kFaceAttributes> &attributes = face.attributes;
+        if constexpr (textured)
+        {
+            assert(u >= 0 && v >= 0 && w >= 0);
+            assert(1.0f - (u + v + w) < 1.0e-4f);
+
+            // model u,v texture coordinates [0,1]
+            const float correction = attributes.perspective(u, v, w);
+            adjustedColor = face.texture->get(
+                attributes.overWAt(kTextureU, u, v, w) * correction,
+                attributes.overWAt(kTextureV, u, v, w) * correction);
+        }
 
-        if (faceDotCamera <= 0.0f)
+        if constexpr (lit)
         {
-            stats.bfCulled++;
-            return false;
+            // normalized anyway, so without the perspective division
+            vec3 vn = v3Normalize(vec3{
+                attributes.overWAt(kNormalX, u, v, w),
+                attributes.overWAt(kNormalY, u, v, w),
+                attributes.overWAt(kNormalZ, u, v, w)});
+            float dp = std::max(0.1f, v3DotProduct(face.lightDirection, vn));
+            adjustedColor = minity::adjustColor(adjustedColor, dp);
         }
-        return true;
+
+        (void)u; (void)v; (void)w; (void)attributes; // unused in the flat permutation
+        return adjustedColor;
+    }
+};
+
+typedef void (*drawFaceFunction)(minity::rasterizer &, const vec3 (&)[3], minity::color, const faceShaderInputs &, depthTest);
+
+// draw a face with one of the modelShader permutations
+template <bool textured, bool lit>
+void drawShadedFace(minity::rasterizer &rasterizer, const vec3 (&vertices)[3], minity::color faceColor, const faceShaderInputs &face, depthTest depthTest)
+{
+    rasterizer.drawTriangle(vertices, faceColor, modelShader<textured, lit>{face}, depthTest);
+}
+
+// depth prepass mode: the transformed faces of the first (depth only)
+// pass, shaded in the second pass without transforming them again
+struct prepassFace
+{
+    vec3 vertices[3]; // screen space
+    minity::color faceColor;
+    faceShaderInputs inputs;
+};
+
+// visibility buffer mode: the faces drawn this frame, indexed by the
+// triangle id in the visibility buffer
+struct visibleFace
+{
+    edgeFunctions edges; // of the screen space vertices, for barycentric coordinates
+    minity::color faceColor;
+    faceShaderInputs inputs;
+};
+
+typedef void (*shadeVisibleFacesFunction)(minity::rasterizer &, const std::vector<visibleFace> &);
+
+// deferred shading of the visibility buffer with one of the modelShader permutations
+template <bool textured, bool lit>
+void shadeVisibleFaces(minity::rasterizer &rasterizer, const std::vector<visibleFace> &faces)
+{
+    rasterizer.shadeVisibilityBuffer([&faces](int x, int y, u_int32_t id) {
+        const visibleFace &face = faces[id];
+        float u, v, w;
+        face.edges.barycentricAt(x, y, u, v, w);
+        return modelShader<textured, lit>::shade(face.inputs, u, v, w, face.faceColor);
+    });
 }
 
 /**
@@ -241,6 +235,28 @@ bool render(minity::scene scene, minity::rasterizer &rasterizer)
     minity::camera &camera = scene.camera;
     minity::light &light = scene.light;
 
+    if (rasterizer.isUnordered() != g_config->unorderedRendering)
+    {
+        rasterizer.setUnordered(g_config->unorderedRendering, g_config->rasterizerThreads);
+    }
+    if (rasterizer.isSortLast() != g_config->sortLastRendering)
+    {
+        rasterizer.setSortLast(g_config->sortLastRendering, g_config->rasterizerThreads);
+    }
+    if (rasterizer.isBinning() != g_config->binnedRendering)
+    {
+        rasterizer.setBinning(g_config->binnedRendering, g_config->rasterizerThreads);
+    }
+    if (rasterizer.isVisibilityBuffer() != g_config->visibilityBuffer)
+    {
+        rasterizer.setVisibilityBuffer(g_config->visibilityBuffer);
+    }
+    if (rasterizer.isTiledLayout() != g_config->tiledFramebuffer)
+    {
+        rasterizer.setTiledLayout(g_config->tiledFramebuffer);
+    }
+    rasterizer.setDepthFormat(static_cast<depthFormat>(g_config->depthFormat));
+    rasterizer.setFillMode(static_cast<fillMode>(g_config->fillMode));
     rasterizer.clearBuffers();
 
     // rough check if we have normals, texture coordinates and texture
@@ -263,50 +279,72 @@ bool render(minity::scene scene, minity::rasterizer &rasterizer)
     float aspectRatio = (float)g_SDLWidth / (float)g_SDLHeight;
     // TODO: add near and far field to minity camera structure
     // TODO: projection matrix should be pre-calculated as it changes only if camera fov changes
-    mat4 projectionMatrix = perspectiveProjectionMatrix(camera.fovDegrees, aspectRatio, 0.1f, 400.0f);
-    mat4 inverseProjectionMatrix = invertMat4(projectionMatrix);
+    // the depth compare of the rasterizer follows its depth format
+    const bool reversedZ = rasterizer.getDepthFormat() == kDepthReversedFloat;
+    mat4 projectionMatrix = perspectiveProjectionMatrix(camera.fovDegrees, aspectRatio, 0.1f, 400.0f, reversedZ);
+
+    // pick the fragment shader permutation once for the whole model
+    // instead of checking the texture and normals for every pixel
+    drawFaceFunction drawFace = hasTexture && hasTextureCoordinates
+        ? (hasNormals ? drawShadedFace<true, true> : drawShadedFace<true, false>)
+        : (hasNormals ? drawShadedFace<false, true> : drawShadedFace<false, false>);
+    shadeVisibleFacesFunction shadeVisible = hasTexture && hasTextureCoordinates
+        ? (hasNormals ? shadeVisibleFaces<true, true> : shadeVisibleFaces<true, false>)
+        : (hasNormals ? shadeVisibleFaces<false, true> : shadeVisibleFaces<false, false>);
+
+    // visibility buffer mode: triangle id -> face, reused between frames
+    static std::vector<visibleFace> visibleFaces{};
+    visibleFaces.clear();
+    // depth prepass mode: the faces to shade, reused between frames
+    static std::vector<prepassFace> prepassFaces{};
+    prepassFaces.clear();
+    const bool depthPrepass = g_config->fillTriangles && g_config->depthPrepass && !g_config->visibilityBuffer;
+    // overlay lines are batched and drawn after the faces, reused between frames
+    static std::vector<std::array<vec3, 2>> wireframe{};
+    static std::vector<std::array<vec3, 2>> normals{};
+    wireframe.clear();
+    normals.clear();
 
     mat4 lightMatrix = light.getLightTransformationMatrix();
     (void)lightMatrix; // TODO: use the light for diffusion
 
-    // TODO: this should be more like: for (auto face : model.faces)
-    assert(model.mesh.indexData.size() % 3 == 0);
-    size_t numFaces = model.mesh.indexData.size() / 3;
-    size_t faceIndex = 0;
-    while(faceIndex < numFaces)
+    // faces within the guard band are drawn without clipping, screen coordinates
+    // up to kMaxScreenCoordinate pixels are exact in the rasterizer
+    const float guardBand = kMaxScreenCoordinate / static_cast<float>(std::max(g_SDLWidth, g_SDLHeight));
+    const float minZ = reversedZ ? 0.0f : -1.0f;
+
+    // FRUSTUM CULLING of the whole model with the bounds of its mesh: a model
+    // outside costs nothing and the faces of a model inside are not clipped
+    const clipResult modelClip = model.mesh.bounds.valid
+        ? clipBounds(model.mesh.bounds, multiplyMat4(projectionMatrix, multiplyMat4(viewMatrix, modelMatrix)), minZ, guardBand)
+        : kClipClipped;
+    if (modelClip == kClipRejected)
     {
-        stats.faces++;
+        stats.culledModels++;
+    }
+    else if (modelClip != kClipClipped)
+    {
+        stats.unclippedModels++;
+    }
+
+    // VERTEX PROCESSING (model to screen space), every vertex once
+    // instead of once per face corner, reused between frames
+    const vertexTransforms transforms{modelMatrix, viewMatrix, projectionMatrix,
+        transposeMat4(inverseModelMatrix), transposeMat4(inverseViewMatrix)};
+    static transformedVertices transformed{};
+    if (modelClip != kClipRejected)
+    {
+        processVertices(model.mesh, transformed, transforms, stats);
+    }
+    // faces split at the near or far plane, drawn after the others, reused between frames
+    static std::vector<clippedFace> clippedFaces{};
+    clippedFaces.clear();
 
+    // RASTERIZATION of a face (or part of it after clipping), working in screen space
+    auto drawClippedFace = [&](const clippedFace &corners, const vec3 (&screen)[3]) {
         // TODO: Bug: the material base color has no effect in software renderer
         minity::color faceColor = model.material.color; // fallback if no texture
 
-        // SEE: spaceType enum for indices
-        // 0 = world, 1 = view, 2 = clip/projected space
-        vec3 vects[5][3] = {};
-        vec3 norms[5][3] = {};
-        vec2 texc[3] = {}; // model u, v for each (model) vertice
-
-        // VERTEX PROCESSING (model to clip space)
-        for (int idx : {0, 1, 2})
-        {
-            processVertices(model, faceIndex, idx, vects, norms, texc,
-                modelMatrix, viewMatrix, projectionMatrix,
-                inverseModelMatrix, inverseViewMatrix, inverseProjectionMatrix,
-                stats);
-        } // end of vertex shader (space transformations)
-
-        faceIndex++;
-
-        if (! clippingFunction(vects[ndcCoordinates], stats))
-        {
-            continue; // ditch this face
-        };
-
-        if (! cullingFunction(vects[viewSpace], stats))
-        {
-            continue; // ditch this face
-        };
-
         // super-simple global Illumination
         vec3 lightDirection = v3Normalize(light.translation);
 
@@ -315,124 +353,173 @@ bool render(minity::scene scene, minity::rasterizer &rasterizer)
             // FLAT SHADING
             // SEE: https://computergraphics.stackexchange.com/questions/4031/programmatically-generating-vertex-normals
             vec3 faceNormal = v3Normalize(v3CrossProduct(
-                v3Sub(vects[viewSpace][2], vects[viewSpace][0]),
-                v3Sub(vects[viewSpace][1], vects[viewSpace][0])));
+                v3Sub(corners[2].view, corners[0].view),
+                v3Sub(corners[1].view, corners[0].view)));
 
             float dp = std::max(0.1f, v3DotProduct(lightDirection, faceNormal));
             faceColor = minity::adjustColor(faceColor, dp);
         }
 
-        // RASTERIZATION, working in screen space
-
         // FRAGMENT SHADER (or pixel shader)
-        // we capture the model and texture from this scope and
-        // pass the shader as a lambda to the renderer
-        auto fragmentShader = [&](float &u, float &v, float &w, minity::color color)
+        // NOTE: per face data is copied into the shader as the binned
+        // rasterizer runs the shader after this face is gone
+        faceShaderInputs face{&model.material.texture, {}, lightDirection};
+        float attributes[3][kFaceAttributes];
+        for (int idx : {0, 1, 2})
         {
-            auto adjustedColor = color; // material color if no texture
-
-
-            if (hasTexture && hasTextureCoordinates)
-            {
-                // get u, v and the corresponding pixel
-
-                // https://stackoverflow.com/questions/74542222/whats-the-relationship-between-the-barycentric-coordinates-of-triangle-in-clip
-                // and
-                // https://stackoverflow.com/questions/24441631/how-exactly-does-opengl-do-perspectively-correct-linear-interpolation
-
-                // Other resources:
-                // https://en.wikipedia.org/wiki/Texture_mapping#Perspective_correctness
-                // https://medium.com/@aminere/software-rendering-from-scratch-f60127a7cd58
-                // "Perspective correct interpolation"
-
-                assert(u >= 0 && v >= 0 && w >= 0);
-                assert(1.0f - (u + v + w) < 1.0e-4f);
-
-                // model u,v texture coordinates [0,1]
-                vec2 tc1 = texc[0];
-                vec2 tc2 = texc[1];
-                vec2 tc3 = texc[2];
-
-                /*
-                from: https://stackoverflow.com/questions/24441631/how-exactly-does-opengl-do-perspectively-correct-linear-interpolation
-
-                The formula that you will find in the GL specification (look on page 427;
-                the link is the current 4.4 spec, but it has always been that way) for
-                perspective-corrected interpolation of the attribute value in a triangle is:
-
-                a * f_a / w_a   +   b * f_b / w_b   +  c * f_c / w_c
-                f=-----------------------------------------------------
-                    a / w_a      +      b / w_b      +     c / w_c
-
-                where a,b,c denote the barycentric coordinates of the point in the triangle
-                we are interpolating for (a,b,c >=0, a+b+c = 1), f_i the attribute value at
-                vertex i, and w_i the clip space w coordinate of vertex i. Note that the
-                barycentric coordinates are calculated only for the 2D projection of the
-                window space coords of the triangle (so z is ignored).
-                */
-
-                float denominator = u / vects[clipSpace][0].w   +   v / vects[clipSpace][1].w  +   w / vects[clipSpace][2].w;
-                float uu = ( u * tc1.u / vects[clipSpace][0].w   +   v * tc2.u / vects[clipSpace][1].w  +   w * tc3.u / vects[clipSpace][2].w ) / denominator;
-                float vv = ( u * tc1.v / vects[clipSpace][0].w   +   v * tc2.v / vects[clipSpace][1].w  +   w * tc3.v / vects[clipSpace][2].w ) / denominator;
-
-                adjustedColor = model.material.texture.get(uu, vv);
-            }
+            attributes[idx][kTextureU] = corners[idx].texcoord.u;
+            attributes[idx][kTextureV] = corners[idx].texcoord.v;
+            attributes[idx][kNormalX] = corners[idx].normal.x;
+            attributes[idx][kNormalY] = corners[idx].normal.y;
+            attributes[idx][kNormalZ] = corners[idx].normal.z;
+        }
+        face.attributes.prepare(attributes, {corners[0].clip.w, corners[1].clip.w, corners[2].clip.w});
 
-            if(hasNormals)
+        if (g_config->fillTriangles && g_config->visibilityBuffer)
+        {
+            // first pass: only depth and the triangle id
+            visibleFace visible{{}, faceColor, face};
+            if (visible.edges.prepare(screen))
             {
-                auto n1 = norms[viewSpace][0];
-                auto n2 = norms[viewSpace][1];
-                auto n3 = norms[viewSpace][2];
-                vec3 vn =  v3Normalize(v3Add(v3Add(v3Mul(n1, u), v3Mul(n2, v)), v3Mul(n3, w)));
-                float dp = std::max(0.1f, v3DotProduct(lightDirection, vn));
-                adjustedColor = minity::adjustColor(adjustedColor, dp);
+                rasterizer.drawTriangle(screen, static_cast<u_int32_t>(visibleFaces.size()));
+                visibleFaces.push_back(visible);
             }
-
-            return adjustedColor;
-        };
-
-        if (g_config->fillTriangles)
+        }
+        else if (depthPrepass)
+        {
+            // first pass: only depth, no shader
+            rasterizer.drawTriangle(screen, faceColor, nullShader, kDepthOnly);
+            prepassFaces.push_back({{screen[0], screen[1], screen[2]}, faceColor, face});
+        }
+        else if (g_config->fillTriangles)
         {
-            rasterizer.drawTriangle(vects[screenSpace], faceColor, fragmentShader);
+            drawFace(rasterizer, screen, faceColor, face, kEarlyDepthTest);
         }
         if (g_config->drawWireframe)
         {
             for (int i = 0; i < 3; ++i)
             {
-                rasterizer.drawLine(vects[screenSpace][i], vects[screenSpace][(i+1) % 3], minity::gray50);
+                wireframe.push_back({screen[i], screen[(i+1) % 3]});
             }
         }
         if (g_config->drawPointCloud)
         {
             for (int i = 0; i < 3; ++i)
             {
-                rasterizer.drawPoint(vects[screenSpace][i], minity::white);
+                rasterizer.drawPoint(screen[i], minity::white);
             }
         }
         if (g_config->drawNormals)
         {
+            vec3 ndc[3];
+            for (int i = 0; i < 3; ++i)
+            {
+                ndc[i] = v3Div(corners[i].clip, corners[i].clip.w);
+            }
             vec3 normal = v3Div(v3Normalize(v3CrossProduct(
-                v3Sub(vects[ndcCoordinates][1], vects[ndcCoordinates][0]),
-                v3Sub(vects[ndcCoordinates][2], vects[ndcCoordinates][0]))),
+                v3Sub(ndc[1], ndc[0]),
+                v3Sub(ndc[2], ndc[0]))),
                 10.0f);
 
             // if v2 or v1 are the same as v0, this will be nan
             if (!std::isnan(normal.x) && !std::isnan(normal.y) && !std::isnan(normal.z))
             {
-                vec3 middle = v3Div(
-                    v3Add(vects[ndcCoordinates][2], v3Add(vects[ndcCoordinates][1], vects[ndcCoordinates][0])),
-                    3);
+                vec3 middle = v3Div(v3Add(ndc[2], v3Add(ndc[1], ndc[0])), 3);
 
                 vec3 tip = v3Add(middle, normal);
 
                 middle = toScreenXY(middle, rasterizer.getViewportWidth(), rasterizer.getViewportHeight());
                 tip = toScreenXY(tip, rasterizer.getViewportWidth(), rasterizer.getViewportHeight());
 
-                rasterizer.drawLine(middle, tip, minity::white);
+                normals.push_back({middle, tip});
             }
         }
         stats.drawnFaces++;
+    };
+
+    // TODO: this should be more like: for (auto face : model.faces)
+    assert(model.mesh.indexData.size() % 3 == 0);
+    size_t numFaces = modelClip == kClipRejected ? 0 : model.mesh.indexData.size() / 3;
+    size_t faceIndex = 0;
+    while(faceIndex < numFaces)
+    {
+        stats.faces++;
+
+        // TRIANGLE ASSEMBLY from the transformed vertices,
+        // only the screen positions before the culling
+        u_int32_t vertices[3];
+        vec3 screen[3];
+        for (int idx : {0, 1, 2})
+        {
+            stats.vertices++;
+            vertices[idx] = model.mesh.indexData[faceIndex * 3 + idx];
+            screen[idx] = transformed.screen.at(vertices[idx]);
+        }
+
+        faceIndex++;
+
+        // w of the screen positions is the clip space w
+        const bool inFront = screen[0].w > 0.0f && screen[1].w > 0.0f && screen[2].w > 0.0f;
+        if (inFront && isCulled(screen, model.culling, model.frontFace))
+        {
+            stats.bfCulled++;
+            continue; // ditch this face
+        }
+
+        clippedFace corners;
+        for (int idx : {0, 1, 2})
+        {
+            const u_int32_t vertex = vertices[idx];
+            corners[idx] = {transformed.clip.at(vertex), transformed.view.at(vertex),
+                            transformed.normal.at(vertex), model.mesh.vertexData[vertex].texcoord};
+        }
+
+        switch (modelClip == kClipClipped ? clipFace(corners, minZ, guardBand, clippedFaces) : kClipInside)
+        {
+        case kClipRejected:
+            stats.vfCulled++;
+            break;
+        case kClipGuardBand:
+            stats.guardBand++;
+            drawClippedFace(corners, screen);
+            break;
+        case kClipInside:
+            drawClippedFace(corners, screen);
+            break;
+        case kClipClipped:
+            stats.clipped++; // drawn below
+            break;
+        }
+    }
+
+    // the faces added by the clipper go to the screen here
+    for (const auto &corners : clippedFaces)
+    {
+        vec3 screen[3];
+        for (int idx : {0, 1, 2})
+        {
+            screen[idx] = v3Div(corners[idx].clip, corners[idx].clip.w);
+            screen[idx] = toScreenXY(screen[idx], g_SDLWidth, g_SDLHeight);
+        }
+        if (isCulled(screen, model.culling, model.frontFace))
+        {
+            stats.bfCulled++;
+            continue;
+        }
+        drawClippedFace(corners, screen);
+    }
+
+    // second pass of the depth prepass: shade the nearest fragment of every pixel
+    if (rasterizer.isUnordered() && !prepassFaces.empty())
+    {
+        rasterizer.finishFrame(); // the unordered mode draws the faces of a frame in any order
     }
+    for (const auto &face : prepassFaces)
+    {
+        drawFace(rasterizer, face.vertices, face.faceColor, face.inputs, kEqualDepth);
+    }
+    rasterizer.drawLines(wireframe.data(), wireframe.size(), minity::gray50);
+    rasterizer.drawLines(normals.data(), normals.size(), minity::white);
 
     if (g_config->drawAxes)
     {
@@ -453,6 +540,15 @@ bool render(minity::scene scene, minity::rasterizer &rasterizer)
         rasterizer.drawLine(origin, oneZ, minity::blue);
     }
 
+    // rasterize the binned triangles (no-op when drawing immediately)
+    rasterizer.finishFrame();
+
+    // second pass of the visibility buffer: shade every visible pixel once
+    if (rasterizer.isVisibilityBuffer())
+    {
+        shadeVisible(rasterizer, visibleFaces);
+    }
+
     // show the drawn buffer
     SDLSwapBuffers(rasterizer);
 
@@ -509,6 +605,44 @@ void softwareEngine::run(scene scene)
         {
             g_config->autoRotate = !g_config->autoRotate;
         }
+        if (m_input.isKeyPressed(KEY_t))
+        {
+            g_config->binnedRendering = !g_config->binnedRendering;
+            g_config->sortLastRendering = false;
+            g_config->unorderedRendering = false;
+        }
+        if (m_input.isKeyPressed(KEY_c))
+        {
+            g_config->sortLastRendering = !g_config->sortLastRendering;
+            g_config->binnedRendering = false;
+            g_config->unorderedRendering = false;
+        }
+        if (m_input.isKeyPressed(KEY_u))
+        {
+            g_config->unorderedRendering = !g_config->unorderedRendering;
+            g_config->binnedRendering = false;
+            g_config->sortLastRendering = false;
+        }
+        if (m_input.isKeyPressed(KEY_v))
+        {
+            g_config->fillMode = (g_config->fillMode + 1) % 3;
+        }
+        if (m_input.isKeyPressed(KEY_b))
+        {
+            g_config->visibilityBuffer = !g_config->visibilityBuffer;
+        }
+        if (m_input.isKeyPressed(KEY_m))
+        {
+            g_config->tiledFramebuffer = !g_config->tiledFramebuffer;
+        }
+        if (m_input.isKeyPressed(KEY_z))
+        {
+            g_config->depthFormat = (g_config->depthFormat + 1) % 4;
+        }
+        if (m_input.isKeyPressed(KEY_o))
+        {
+            g_config->depthPrepass = !g_config->depthPrepass;
+        }
 
 
         scene.model.update(deltaTime);
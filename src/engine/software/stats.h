@@ -4,10 +4,15 @@
 
 struct renderStats
 {
-    unsigned long int vertices{0};
+    unsigned long int vertices{0}; // face corners
+    unsigned long int shadedVertices{0}; // vertex shader calls, once per mesh vertex
+    unsigned long int culledModels{0}; // outside the view volume (mesh bounds)
+    unsigned long int unclippedModels{0}; // inside the view volume, no face clipping
     unsigned long int faces{0};
-    unsigned long int bfCulled{0};
+    unsigned long int bfCulled{0}; // by the cull mode of the model
     unsigned long int vfCulled{0};
+    unsigned long int clipped{0}; // split at the near or far plane (or the guard band)
+    unsigned long int guardBand{0}; // crossing only the screen sides, drawn without clipping
     unsigned long int drawnFaces{0};
     friend std::ostream& operator<<(std::ostream& os, const renderStats &stats);
 };
@@ -17,13 +22,49 @@ std::ostream& operator<<( std::ostream &os, const renderStats &stats )
 {
     os << "render statistics:" << std::endl
        << "  vertices     " << stats.vertices << std::endl
+       << "  shaded verts " << stats.shadedVertices << std::endl
+       << "  culled model " << stats.culledModels << std::endl
+       << "  no clipping  " << stats.unclippedModels << std::endl
        << "  faces        " << stats.faces << std::endl
        << "  bf-culled    " << stats.bfCulled << std::endl
        << "  vf-culled    " << stats.vfCulled << std::endl
+       << "  clipped      " << stats.clipped << std::endl
+       << "  guard band   " << stats.guardBand << std::endl
        << "  drawn faces  " << stats.drawnFaces << std::endl;
     return os;
 }
 
+// Detail of the rasterizer statistics, selected at compile time with
+// -DMINITY_RASTERIZER_STATS=0, 1 or 2 (default). Counters are collected
+// per tile (thread) in the binned mode and merged when the frame is finished.
+enum statsLevel
+{
+    kNoStats = 0, // compiled out
+    kFrameStats = 1, // per primitive and per block counters
+    kPixelStats = 2 // per pixel counters as well
+};
+#ifndef MINITY_RASTERIZER_STATS
+#define MINITY_RASTERIZER_STATS 2
+#endif
+const statsLevel kRasterizerStats{static_cast<statsLevel>(MINITY_RASTERIZER_STATS)};
+
+// counting policy of the rasterizer loops: counters of a finer detail
+// than Level are no-ops, so they cost nothing in the inner loops
+template <statsLevel Level>
+struct statsPolicy
+{
+    static void frame(unsigned long int &counter, unsigned long int n = 1)
+    {
+        if constexpr (Level >= kFrameStats)
+            counter += n;
+    }
+    static void pixel(unsigned long int &counter, unsigned long int n = 1)
+    {
+        if constexpr (Level >= kPixelStats)
+            counter += n;
+    }
+};
+
 struct rasterizerStats
 {
     unsigned long int triangles{0};
@@ -31,27 +72,74 @@ struct rasterizerStats
     unsigned long int points{0};
     unsigned long int xyClipped{0};
     unsigned long int degenerate{0};
+    unsigned long int culled{0}; // no pixel center in the bounding box
+    unsigned long int tiny{0}; // fast path of triangles within 2x2 pixels
+    unsigned long int small{0}; // fast path of triangles within 4x4 pixels
     unsigned long int outside{0};
     unsigned long int inside{0};
     unsigned long int depth{0};
+    unsigned long int shaded{0};
+    unsigned long int blocksRejected{0};
+    unsigned long int blocksAccepted{0};
+    unsigned long int blocksPartial{0};
+    unsigned long int blocksDepthRejected{0};
+    rasterizerStats &operator+=(const rasterizerStats &other);
     friend std::ostream& operator<<(std::ostream& os, const rasterizerStats &stats);
 };
 
+// merge e.g. per tile statistics
+rasterizerStats &rasterizerStats::operator+=(const rasterizerStats &other)
+{
+    triangles += other.triangles;
+    lines += other.lines;
+    points += other.points;
+    xyClipped += other.xyClipped;
+    degenerate += other.degenerate;
+    culled += other.culled;
+    tiny += other.tiny;
+    small += other.small;
+    outside += other.outside;
+    inside += other.inside;
+    depth += other.depth;
+    shaded += other.shaded;
+    blocksRejected += other.blocksRejected;
+    blocksAccepted += other.blocksAccepted;
+    blocksPartial += other.blocksPartial;
+    blocksDepthRejected += other.blocksDepthRejected;
+    return *this;
+}
+
 // for std::cout << myRasterizerStats;
+// only the counters of the compiled in statistics level are printed
 std::ostream& operator<<( std::ostream &os, const rasterizerStats &stats )
 {
-    float pixelPercentage = 100.0f * stats.inside / (stats.inside + stats.outside);
-    os << "rasterizer statistics:" << std::endl
-       << "  triangles    " << stats.triangles << std::endl
+    os << "rasterizer statistics:" << std::endl;
+    if (kRasterizerStats == kNoStats)
+        return os << "  compiled out (MINITY_RASTERIZER_STATS=0)" << std::endl;
+
+    os << "  triangles    " << stats.triangles << std::endl
        << "  lines        " << stats.lines << std::endl
-       << "  points       " << stats.points << std::endl
        << "  xy-clipped   " << stats.xyClipped << std::endl
        << "  degenerate   " << stats.degenerate << std::endl
-       << "  outside      " << stats.outside << std::endl
-       << "  inside       " << stats.inside << std::endl
-       << "  in : out     " << pixelPercentage << std::endl
-       << "  drawn points " << stats.points << std::endl
-       << "  depth        " << stats.depth << std::endl;
+       << "  culled       " << stats.culled << std::endl
+       << "  tiny (2x2)   " << stats.tiny << std::endl
+       << "  small (4x4)  " << stats.small << std::endl;
+    if (kRasterizerStats >= kPixelStats)
+    {
+        const unsigned long int tested = stats.inside + stats.outside;
+        const float pixelPercentage = tested ? 100.0f * stats.inside / tested : 0.0f;
+        os << "  points       " << stats.points << std::endl
+           << "  outside      " << stats.outside << std::endl
+           << "  inside       " << stats.inside << std::endl
+           << "  in : out     " << pixelPercentage << std::endl
+           << "  drawn points " << stats.points << std::endl
+           << "  depth        " << stats.depth << std::endl
+           << "  shaded       " << stats.shaded << std::endl;
+    }
+    os << "  blocks" << std::endl
+       << "    rejected   " << stats.blocksRejected << std::endl
+       << "    accepted   " << stats.blocksAccepted << std::endl
+       << "    partial    " << stats.blocksPartial << std::endl
+       << "    depth rej. " << stats.blocksDepthRejected << std::endl;
     return os;
 }
-
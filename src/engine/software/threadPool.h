@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace minity
+{
+
+/**
+ * @brief minimal pool of worker threads for data parallel loops
+ *
+ * The workers sleep until parallelFor hands them a new job and then
+ * pick indices from a shared counter until the job is done. The calling
+ * thread works as well, so a pool of size 1 has no worker threads at all.
+ */
+class threadPool
+{
+public:
+    explicit threadPool(unsigned int threads);
+    ~threadPool();
+    threadPool(const threadPool &) = delete;
+    threadPool &operator=(const threadPool &) = delete;
+
+    // run job(i) for all i in [0, count) and wait for them to finish
+    void parallelFor(size_t count, std::function<void(size_t)> job);
+    unsigned int size() { return m_size; };
+
+private:
+    void work();
+    void runJob();
+
+    unsigned int m_size{1};
+    std::vector<std::thread> m_workers{};
+    std::mutex m_mutex{};
+    std::condition_variable m_wakeUp{};
+    std::condition_variable m_done{};
+    std::function<void(size_t)> m_job{};
+    size_t m_count{0};
+    std::atomic<size_t> m_next{0};
+    unsigned long int m_generation{0};
+    unsigned int m_busy{0};
+    bool m_shutdown{false};
+};
+
+threadPool::threadPool(unsigned int threads)
+    : m_size(threads > 0 ? threads : 1)
+{
+    for (unsigned int i = 1; i < m_size; ++i)
+        m_workers.emplace_back(&threadPool::work, this);
+}
+
+threadPool::~threadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_wakeUp.notify_all();
+    for (auto &worker : m_workers)
+        worker.join();
+}
+
+void threadPool::parallelFor(size_t count, std::function<void(size_t)> job)
+{
+    if (m_workers.empty() || count < 2)
+    {
+        for (size_t i = 0; i < count; ++i)
+            job(i);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_job = job;
+        m_count = count;
+        m_next = 0;
+        m_busy = m_workers.size();
+        m_generation++;
+    }
+    m_wakeUp.notify_all();
+
+    runJob();
+
+    // the job must outlive the workers using it
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this]() { return m_busy == 0; });
+    m_job = nullptr;
+}
+
+void threadPool::runJob()
+{
+    for (size_t i = m_next++; i < m_count; i = m_next++)
+        m_job(i);
+}
+
+void threadPool::work()
+{
+    unsigned long int generation{0};
+    while (true)
+    {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wakeUp.wait(lock, [&]() { return m_shutdown || m_generation != generation; });
+            if (m_shutdown)
+                return;
+            generation = m_generation;
+        }
+
+        runJob();
+
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_busy--;
+        }
+        m_done.notify_one();
+    }
+}
+
+} // NS minity
@@ -0,0 +1,59 @@
+#pragma once
+
+namespace minity
+{
+
+/**
+ * @brief perspective correct interpolation of N float attributes
+ *
+ * The attributes divided by clip space w, and 1/w itself, are linear in
+ * screen space. prepare divides them once per triangle, so a fragment only
+ * interpolates them with its screen space barycentric coordinates (the
+ * u, v, w the rasterizer hands to the shader) and multiplies them by one
+ * reciprocal of the interpolated 1/w.
+ *
+ * @tparam N number of attributes, e.g. texture u, v and the normal x, y, z
+ *
+ * @see https://stackoverflow.com/questions/24441631/how-exactly-does-opengl-do-perspectively-correct-linear-interpolation
+ */
+template <int N>
+struct varyings
+{
+    // values[vertex][attribute] and the clip space w of the vertices
+    void prepare(const float (&values)[3][N], const float (&clipW)[3])
+    {
+        for (int vertex : {0, 1, 2})
+        {
+            oneOverW[vertex] = 1.0f / clipW[vertex];
+            for (int i = 0; i < N; ++i)
+                overW[i][vertex] = values[vertex][i] * oneOverW[vertex];
+        }
+    }
+
+    // the attributes at the screen space barycentric coordinates u, v, w
+    void at(float u, float v, float w, float (&values)[N]) const
+    {
+        const float correction = perspective(u, v, w);
+        for (int i = 0; i < N; ++i)
+            values[i] = overWAt(i, u, v, w) * correction;
+    }
+
+    // w at u, v, w: the one division per fragment
+    float perspective(float u, float v, float w) const
+    {
+        return 1.0f / (oneOverW[0] * u + oneOverW[1] * v + oneOverW[2] * w);
+    }
+
+    // attribute i / w at u, v, w, times perspective() it's the attribute.
+    // Directions that are normalized anyway (e.g. normals) can skip the
+    // multiply and don't have to wait for the division.
+    float overWAt(int i, float u, float v, float w) const
+    {
+        return overW[i][0] * u + overW[i][1] * v + overW[i][2] * w;
+    }
+
+    float oneOverW[3]{0};
+    float overW[N][3]{}; // attribute / w of the vertices
+};
+
+} // NS minity
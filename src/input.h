@@ -32,6 +32,14 @@ enum keyCode
     KEY_n = SDLK_n, // draw normals "(n)ormals"
     KEY_p = SDLK_p, // draw point cloud "(p)oints"
     KEY_x = SDLK_x, // draw axes "a(x)es"
+    KEY_t = SDLK_t, // binned rendering "(t)iles"
+    KEY_v = SDLK_v, // simd rasterizer "(v)ectorized"
+    KEY_b = SDLK_b, // visibility "(b)uffer" rendering
+    KEY_m = SDLK_m, // tiled "(m)emory" layout of the buffers
+    KEY_z = SDLK_z, // cycle the "(z)-buffer" formats
+    KEY_o = SDLK_o, // depth prepass, no "(o)verdraw"
+    KEY_c = SDLK_c, // sort-last rendering with depth "(c)ompositing"
+    KEY_u = SDLK_u, // "(u)nordered" rendering with atomic pixels
     KEY_F1 = SDLK_F1, // show stats window
 };
 
@@ -115,6 +123,30 @@ bool input::handleInput()
             case SDLK_x:
                 pressedKeys.insert(KEY_x);
                 break;
+            case SDLK_t:
+                pressedKeys.insert(KEY_t);
+                break;
+            case SDLK_v:
+                pressedKeys.insert(KEY_v);
+                break;
+            case SDLK_b:
+                pressedKeys.insert(KEY_b);
+                break;
+            case SDLK_m:
+                pressedKeys.insert(KEY_m);
+                break;
+            case SDLK_z:
+                pressedKeys.insert(KEY_z);
+                break;
+            case SDLK_o:
+                pressedKeys.insert(KEY_o);
+                break;
+            case SDLK_c:
+                pressedKeys.insert(KEY_c);
+                break;
+            case SDLK_u:
+                pressedKeys.insert(KEY_u);
+                break;
             case SDLK_F1:
                 pressedKeys.insert(KEY_F1);
                 break;
@@ -27,6 +27,14 @@ key bindings:
     n key      - draw normals
     p key      - draw point cloud
     x key      - draw axes
+    t key      - binned multithreaded rasterizer
+    c key      - sort-last multithreaded rasterizer (depth compositing)
+    u key      - unordered multithreaded rasterizer (atomic depth and color)
+    v key      - triangle fill (scalar, simd vectorized, scanline)
+    b key      - visibility buffer (deferred shading)
+    m key      - tiled (8x8 block) frame and depth buffer layout
+    z key      - depth buffer format (float, reversed-Z float, 24/16 bit unorm)
+    o key      - depth prepass (shade every pixel once)
     q key      - quit minity
     F1 key     - show stats window)";
 
@@ -78,6 +86,8 @@ void runScenario()
     model.rotation = vec3{deg2rad(0), deg2rad(0), deg2rad(0)};
     // model.position = vec3{0.0f, 0.0f, -2.0f};
     model.position = vec3{0.0f, 0.0f, 2.0f};
+    // model.culling = minity::kCullNone; // e.g. for open meshes seen from both sides
+    // model.frontFace = minity::kCounterClockwise; // instead of meshImporter reverseWinding
     // african head parameters
     // model.scale = vec3{2.0f, 2.0f, 2.0f};
     // model.rotation = vec3{deg2rad(0), deg2rad(0), deg2rad(0)};
@@ -1,5 +1,8 @@
 #pragma once
 
+#include <memory>
+#include <vector>
+
 namespace minity
 {
 
@@ -10,13 +13,44 @@ struct vertexData
     vec2 texcoord;
 };
 
+// bounding volumes of the vertex positions in model space
+struct meshBounds
+{
+    vec3 min{}; // axis aligned bounding box
+    vec3 max{};
+    vec3 center{}; // bounding sphere
+    float radius{0.0f};
+    bool valid{false}; // set by computeBounds, e.g. not for hand-made meshes
+};
+
 struct mesh
 {
     std::vector<vertexData> vertexData;
     std::vector<u_int32_t> indexData;
+    meshBounds bounds{};
+};
+
+// which faces of a model are not drawn
+enum cullMode
+{
+    kCullNone,
+    kCullFront,
+    kCullBack // default
+};
+
+// the winding order of the front faces as seen on the screen
+enum winding
+{
+    kClockwise, // default, use meshImporter reverseWinding for counter-clockwise .obj files
+    kCounterClockwise
 };
 
 void printMesh(mesh &mesh);
+void computeBounds(mesh &mesh);
+std::shared_ptr<minity::mesh> getSingleFaceMesh();
+std::shared_ptr<minity::mesh> getSquareMesh();
+std::shared_ptr<minity::mesh> getCubeMesh();
+std::shared_ptr<minity::mesh> getSphereMesh(size_t meridians, size_t parallels);
 
 #ifdef MESH_UTILS_IMPLEMENTATION
 
@@ -31,6 +65,7 @@ std::shared_ptr<minity::mesh> getSingleFaceMesh()
         { { -1.0f, 1.0f, 0.0f },  {  0.f,  0.f,  1.f }, { 0.f, 0.f } },
         { { 1.0f, 1.0f, 0.0f },   {  0.f,  0.f,  1.f }, { 1.f, 0.f } },
     };
+    computeBounds(*_mesh);
     return _mesh;
 }
 
@@ -46,6 +81,7 @@ std::shared_ptr<minity::mesh> getSquareMesh()
         { { 1.0f, 1.0f, 0.0f },   {  0.f,  0.f,  1.f }, { 1.f, 0.f } },
         { { 1.0f, -1.0f, 0.0f },  {  0.f,  0.f,  1.f }, { 1.f, 1.f } },
     };
+    computeBounds(*_mesh);
     return _mesh;
 }
 
@@ -95,6 +131,7 @@ std::shared_ptr<minity::mesh> getCubeMesh()
         { { +s, -s, +s }, {  0.f, -1.f,  0.f }, { 1.f, 0.f } },
         { { +s, -s, -s }, {  0.f, -1.f,  0.f }, { 1.f, 1.f } },
     };
+    computeBounds(*_mesh);
     return _mesh;
 }
 
@@ -164,9 +201,41 @@ std::shared_ptr<minity::mesh> getSphereMesh(size_t meridians, size_t parallels)
         }
     }
 
+    computeBounds(*_mesh);
     return _mesh;
 }
 
+// the box of the positions and a sphere around its center (not the
+// smallest sphere, but cheap and close for the usual models)
+void computeBounds(mesh &mesh)
+{
+    mesh.bounds = meshBounds{};
+    if (mesh.vertexData.empty())
+        return;
+
+    vec3 min = mesh.vertexData[0].position;
+    vec3 max = min;
+    for (const auto &vertex : mesh.vertexData)
+    {
+        min.x = std::min(min.x, vertex.position.x);
+        min.y = std::min(min.y, vertex.position.y);
+        min.z = std::min(min.z, vertex.position.z);
+        max.x = std::max(max.x, vertex.position.x);
+        max.y = std::max(max.y, vertex.position.y);
+        max.z = std::max(max.z, vertex.position.z);
+    }
+    const vec3 center{(min.x + max.x) * 0.5f, (min.y + max.y) * 0.5f, (min.z + max.z) * 0.5f};
+    float radiusSquared{0.0f};
+    for (const auto &vertex : mesh.vertexData)
+    {
+        const float dx = vertex.position.x - center.x;
+        const float dy = vertex.position.y - center.y;
+        const float dz = vertex.position.z - center.z;
+        radiusSquared = std::max(radiusSquared, dx * dx + dy * dy + dz * dz);
+    }
+    mesh.bounds = meshBounds{{min.x, min.y, min.z}, {max.x, max.y, max.z}, center, std::sqrt(radiusSquared), true};
+}
+
 void printMesh(mesh &mesh)
 {
     std::cout << "mesh: " << std::endl;
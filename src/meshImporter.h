@@ -67,6 +67,7 @@ std::shared_ptr<mesh> meshImporter::load(const std::string &path, bool reverseWi
 
     m_mesh->vertexData = meshVertices;
     m_mesh->indexData = meshIndices;
+    computeBounds(*m_mesh);
     return m_mesh;
 }
 
@@ -90,6 +91,7 @@ std::shared_ptr<mesh> meshImporter::loadFromString(const std::string &meshString
 
     m_mesh->vertexData = meshVertices;
     m_mesh->indexData = meshIndices;
+    computeBounds(*m_mesh);
     return m_mesh;
 }
 
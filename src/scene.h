@@ -77,6 +77,8 @@ struct model
     vec3 position{};
     vec3 rotation{};
     vec3 scale{};
+    cullMode culling{kCullBack};
+    winding frontFace{kClockwise};
     mat4 getModelTransformMatrix();
     updateMethod update = nullUpdater;
     void setUpdate(updateMethodFactory updateMaker) { update = updateMaker(this); }
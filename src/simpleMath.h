@@ -1,7 +1,9 @@
 #pragma once
 
 #include <cmath>
+#include <algorithm>
 #include <cassert>
+#include <cstring>
 #include <string>
 #include <vector>
 #include <iostream> // << overload for catch2
@@ -93,6 +95,25 @@ struct mat4
     friend std::ostream& operator<<(std::ostream& os, const mat4 &value);
 };
 
+// vec3s as one array per component (structure of arrays),
+// the output of the batch transforms below
+struct vec3SoA
+{
+    std::vector<float> x{};
+    std::vector<float> y{};
+    std::vector<float> z{};
+    std::vector<float> w{};
+    void resize(size_t count)
+    {
+        x.resize(count);
+        y.resize(count);
+        z.resize(count);
+        w.resize(count);
+    };
+    size_t size() const { return x.size(); };
+    vec3 at(size_t i) const { return {x[i], y[i], z[i], w[i]}; };
+};
+
 // forward declarations:
 void printMat4(const mat4 &mat, std::ostream& os = std::cout);
 void printVec3(const vec3 &v);
@@ -116,6 +137,16 @@ mat4 rotateZMatrix(float fAngleRad);
 mat4 translateMatrix(const float x, const float y, const float z);
 mat4 lookAtMatrixRH(const vec3 &eye, const vec3 &center, const vec3 &tmp);
 mat4 fpsLookAtMatrixRH(vec3 eye, float pitch, float yaw);
+mat4 perspectiveProjectionMatrix(float fFovDegrees, float fAspectRatio, float fNear, float fFar, bool reversedZ = false);
+
+// batch versions of multiplyVec3(vec3, mat4) for count vec3s that are
+// stride bytes apart, e.g. &mesh.vertexData[0].position and sizeof(vertexData)
+void transformPositions(const vec3 *positions, size_t count, size_t stride, const mat4 &m, vec3SoA &out);
+// the same (clip space positions) with the perspective divide and the viewport
+// mapping of width x height (y down) to screen positions in one pass,
+// z of the screen positions is in NDC and w is the clip space w
+void projectPositions(const vec3 *positions, size_t count, size_t stride, const mat4 &m,
+                      float width, float height, vec3SoA &clip, vec3SoA &screen);
 
 constexpr float deg2rad(float degrees)
 {
@@ -275,7 +306,10 @@ mat4 translateMatrix(const float x, const float y, const float z)
 
 // perspective projection:
 // see: https://unspecified.wordpress.com/2012/06/21/calculating-the-gluperspective-matrix-and-other-opengl-matrix-maths/
-mat4 perspectiveProjectionMatrix(float fFovDegrees, float fAspectRatio, float fNear, float fFar)
+// reversed-Z maps the near plane to z = 1 and the far plane to z = 0 instead of -1 and 1,
+// the float precision near 0 then makes up for the 1/z distribution of the depth
+// see: https://developer.nvidia.com/content/depth-precision-visualized
+mat4 perspectiveProjectionMatrix(float fFovDegrees, float fAspectRatio, float fNear, float fFar, bool reversedZ)
 {
     assert(fNear >= 0.0f && fFar >= 0.0f && fNear <= fFar);
 
@@ -294,6 +328,11 @@ mat4 perspectiveProjectionMatrix(float fFovDegrees, float fAspectRatio, float fN
     // To fix this, we can invert the Z coordinate (...[2][2] = -1)
     out.m[2][2] = (fFar + fNear) / (fNear - fFar);      // Same as OpenGL: - (zFar + zNear) / (zFar - zNear);
     out.m[2][3] = (2 * fFar * fNear) / (fNear - fFar);  // Same as OpenGL: - (2 * zFar * zNear) / (zFar - zNear);
+    if (reversedZ)
+    {
+        out.m[2][2] = fNear / (fFar - fNear);
+        out.m[2][3] = (fFar * fNear) / (fFar - fNear);
+    }
     // w
     out.m[3][2] = -1.0f; // w = -z which will be divided again
     return out;
@@ -331,6 +370,92 @@ mat4 multiplyMat4(const mat4 &m1, const mat4 &m2)
     return out;
 }
 
+// The batch transforms work on kMathLanes vertices at a time with the
+// gcc/clang vector extensions (SSE or AVX2 with -mavx2, NEON on arm64):
+// the positions are transposed to one vector per component on load and
+// the matrix stays in registers as one splatted vector per element.
+// SEE: https://gcc.gnu.org/onlinedocs/gcc/Vector-Extensions.html
+#if defined(__AVX2__)
+const int kMathLanes{8};
+#else
+const int kMathLanes{4};
+#endif
+typedef float mathFloatv __attribute__((vector_size(kMathLanes * sizeof(float))));
+
+// calls store(first, lanes, x, y, z, w) with the transformed vertices
+// [first, first + lanes) as multiplyVec3(positions[i], m) would
+template <typename Store>
+void transformBatches(const vec3 *positions, size_t count, size_t stride, const mat4 &m, Store store)
+{
+    mathFloatv matrix[4][4];
+    for (int r = 0; r < 4; r++)
+        for (int c = 0; c < 4; c++)
+            matrix[r][c] = mathFloatv{} + m.m[r][c];
+
+    const char *bytes = reinterpret_cast<const char *>(positions);
+    for (size_t first = 0; first < count; first += kMathLanes)
+    {
+        const int lanes = static_cast<int>(std::min<size_t>(kMathLanes, count - first));
+        mathFloatv x{}, y{}, z{}, w{};
+        for (int lane = 0; lane < lanes; ++lane)
+        {
+            const vec3 &i = *reinterpret_cast<const vec3 *>(bytes + (first + lane) * stride);
+            x[lane] = i.x;
+            y[lane] = i.y;
+            z[lane] = i.z;
+            w[lane] = i.w;
+        }
+        store(first, lanes,
+            x * matrix[0][0] + y * matrix[0][1] + z * matrix[0][2] + w * matrix[0][3],
+            x * matrix[1][0] + y * matrix[1][1] + z * matrix[1][2] + w * matrix[1][3],
+            x * matrix[2][0] + y * matrix[2][1] + z * matrix[2][2] + w * matrix[2][3],
+            x * matrix[3][0] + y * matrix[3][1] + z * matrix[3][2] + w * matrix[3][3]);
+    }
+}
+
+inline void storeMathLanes(std::vector<float> &out, size_t first, int lanes, const mathFloatv &v)
+{
+    if (lanes == kMathLanes)
+        std::memcpy(out.data() + first, &v, sizeof(v));
+    else
+        std::memcpy(out.data() + first, &v, lanes * sizeof(float));
+}
+
+void transformPositions(const vec3 *positions, size_t count, size_t stride, const mat4 &m, vec3SoA &out)
+{
+    out.resize(count);
+    transformBatches(positions, count, stride, m,
+        [&](size_t first, int lanes, mathFloatv x, mathFloatv y, mathFloatv z, mathFloatv w) {
+            storeMathLanes(out.x, first, lanes, x);
+            storeMathLanes(out.y, first, lanes, y);
+            storeMathLanes(out.z, first, lanes, z);
+            storeMathLanes(out.w, first, lanes, w);
+        });
+}
+
+void projectPositions(const vec3 *positions, size_t count, size_t stride, const mat4 &m,
+                      float width, float height, vec3SoA &clip, vec3SoA &screen)
+{
+    clip.resize(count);
+    screen.resize(count);
+    transformBatches(positions, count, stride, m,
+        [&](size_t first, int lanes, mathFloatv x, mathFloatv y, mathFloatv z, mathFloatv w) {
+            storeMathLanes(clip.x, first, lanes, x);
+            storeMathLanes(clip.y, first, lanes, y);
+            storeMathLanes(clip.z, first, lanes, z);
+            storeMathLanes(clip.w, first, lanes, w);
+            // the unused lanes divide 0 by 0, they are not stored
+            x /= w;
+            y /= w;
+            z /= w;
+            // (-1, 1) is the top left corner, z stays in NDC for the depth buffer
+            storeMathLanes(screen.x, first, lanes, (x + 1.0f) * width / 2.0f);
+            storeMathLanes(screen.y, first, lanes, (1.0f - ((y + 1.0f) / 2.0f)) * height);
+            storeMathLanes(screen.z, first, lanes, z);
+            storeMathLanes(screen.w, first, lanes, w);
+        });
+}
+
 // TODO: check if these are still valid references/notes
 // https://www.scratchapixel.com/lessons/mathematics-physics-for-computer-graphics/lookat-function (looks flaky)
 // https://github.com/g-truc/glm/blob/master/glm/ext/matrix_transform.inl#L99 (lookAtRH)
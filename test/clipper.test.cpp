@@ -0,0 +1,149 @@
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <vector>
+
+#define MATH_TYPES_ONLY
+#include "simpleMath.h"
+#include "engine/software/clipper.h"
+
+// a face to clip from clip space positions, u of the texture coordinates is the vertex index
+minity::clippedFace getClipFace(const vec3 &v0, const vec3 &v1, const vec3 &v2)
+{
+    return {{{v0, {}, {}, {0.0f, 0.0f}}, {v1, {}, {}, {1.0f, 0.0f}}, {v2, {}, {}, {2.0f, 0.0f}}}};
+}
+
+TEST_CASE("faces inside the guard band are not clipped")
+{
+    std::vector<minity::clippedFace> out;
+    SECTION("inside the screen") {
+        auto face = getClipFace({-1.0f, -1.0f, 0.0f, 2.0f}, {1.0f, 1.0f, 0.5f, 2.0f}, {1.0f, -1.0f, 1.0f, 2.0f});
+        REQUIRE(minity::clipFace(face, -1.0f, 8.0f, out) == minity::kClipInside);
+    }
+    SECTION("crossing the screen sides") {
+        auto face = getClipFace({-3.0f, 0.0f, 0.0f, 1.0f}, {7.0f, 5.0f, 0.0f, 1.0f}, {0.0f, -6.0f, 0.0f, 1.0f});
+        REQUIRE(minity::clipFace(face, -1.0f, 8.0f, out) == minity::kClipGuardBand);
+    }
+    SECTION("outside one screen side") {
+        auto face = getClipFace({1.5f, 0.0f, 0.0f, 1.0f}, {9.0f, 5.0f, 0.0f, 1.0f}, {1.1f, -60.0f, 0.0f, 1.0f});
+        REQUIRE(minity::clipFace(face, -1.0f, 8.0f, out) == minity::kClipRejected);
+    }
+    SECTION("behind the camera") {
+        auto face = getClipFace({0.0f, 0.0f, 2.0f, -1.0f}, {1.0f, 0.0f, 2.0f, -1.0f}, {0.0f, 1.0f, 3.0f, -2.0f});
+        REQUIRE(minity::clipFace(face, -1.0f, 8.0f, out) == minity::kClipRejected);
+    }
+    REQUIRE(out.empty());
+}
+
+TEST_CASE("faces crossing the near plane are clipped in clip space")
+{
+    std::vector<minity::clippedFace> out;
+    // z >= -w is in front of the near plane
+    SECTION("one vertex behind makes two faces") {
+        auto face = getClipFace({0.0f, 0.0f, 0.0f, 1.0f}, {0.5f, 0.0f, -3.0f, 1.0f}, {0.0f, 0.5f, 0.0f, 1.0f});
+        REQUIRE(minity::clipFace(face, -1.0f, 8.0f, out) == minity::kClipClipped);
+        REQUIRE(out.size() == 2);
+    }
+    SECTION("two vertices behind make one face") {
+        auto face = getClipFace({0.0f, 0.0f, 0.0f, 1.0f}, {0.5f, 0.0f, -3.0f, 1.0f}, {0.0f, 0.5f, -3.0f, 1.0f});
+        REQUIRE(minity::clipFace(face, -1.0f, 8.0f, out) == minity::kClipClipped);
+        REQUIRE(out.size() == 1);
+        // z = -w = -1 is a third of the way from z = 0 to z = -3
+        REQUIRE(out[0][0].clip == vec3{0.0f, 0.0f, 0.0f, 1.0f});
+        REQUIRE(out[0][1].clip == vec3{1.0f / 6.0f, 0.0f, -1.0f, 1.0f});
+        REQUIRE(out[0][2].clip == vec3{0.0f, 1.0f / 6.0f, -1.0f, 1.0f});
+        REQUIRE(out[0][1].texcoord.u == Approx(1.0f / 3.0f));
+        REQUIRE(out[0][2].texcoord.u == Approx(2.0f / 3.0f));
+    }
+    SECTION("reversed-Z clips at the near plane z <= w") {
+        auto face = getClipFace({0.0f, 0.0f, 0.5f, 1.0f}, {0.5f, 0.0f, 2.0f, 1.0f}, {0.0f, 0.5f, 0.5f, 1.0f});
+        REQUIRE(minity::clipFace(face, 0.0f, 8.0f, out) == minity::kClipClipped);
+        REQUIRE(out.size() == 2);
+    }
+    for (auto &clipped : out)
+    {
+        for (auto &vertex : clipped)
+        {
+            REQUIRE(vertex.clip.w > 0.0f);
+            REQUIRE(vertex.clip.z <= vertex.clip.w * (1.0f + 1e-6f));
+            REQUIRE(vertex.clip.z >= -vertex.clip.w * (1.0f + 1e-6f));
+        }
+        // the winding (screen space area sign) of the original face
+        auto area = [](const minity::clipVertex (&v)[3]) {
+            vec3 ndc[3];
+            for (int i : {0, 1, 2})
+                ndc[i] = {v[i].clip.x / v[i].clip.w, v[i].clip.y / v[i].clip.w};
+            return (ndc[1].x - ndc[0].x) * (ndc[2].y - ndc[0].y) - (ndc[2].x - ndc[0].x) * (ndc[1].y - ndc[0].y);
+        };
+        REQUIRE(area({clipped[0], clipped[1], clipped[2]}) > 0.0f);
+    }
+}
+
+TEST_CASE("faces sharing a clipped edge get the same new vertex")
+{
+    const vec3 front{0.3f, -0.2f, 0.1f, 1.3f};
+    const vec3 behind{-0.7f, 0.9f, 5.0f, -2.1f};
+    std::vector<minity::clippedFace> out;
+    REQUIRE(minity::clipFace(getClipFace(front, behind, {0.5f, 0.5f, 0.0f, 1.0f}), -1.0f, 8.0f, out) == minity::kClipClipped);
+    REQUIRE(minity::clipFace(getClipFace(behind, front, {-0.5f, -0.5f, 0.0f, 1.0f}), -1.0f, 8.0f, out) == minity::kClipClipped);
+    auto hasVertex = [&out](size_t first, size_t last, const vec3 &clip) {
+        for (size_t i = first; i < last; ++i)
+            for (auto &vertex : out[i])
+                if (vertex.clip.x == clip.x && vertex.clip.y == clip.y && vertex.clip.z == clip.z && vertex.clip.w == clip.w)
+                    return true;
+        return false;
+    };
+    // the new vertex of the first face on the shared edge
+    REQUIRE(out[0][1].clip != front);
+    REQUIRE(hasVertex(1, out.size(), out[0][1].clip));
+}
+
+TEST_CASE("mesh bounds are tested against the view volume")
+{
+    // the bounds of the unit sphere and of a flat square, see the mesh generators
+    minity::meshBounds sphere{{-1.0f, -1.0f, -1.0f}, {1.0f, 1.0f, 1.0f}, {0.0f, 0.0f, 0.0f}, 1.0f, true};
+    minity::meshBounds square{{-1.0f, -1.0f, 0.0f}, {1.0f, 1.0f, 0.0f}, {0.0f, 0.0f, 0.0f}, std::sqrt(2.0f), true};
+    // camera at the origin looking at -z, 90 degrees field of view
+    const mat4 viewProjection = multiplyMat4(perspectiveProjectionMatrix(90.0f, 1.0f, 0.1f, 100.0f),
+                                             lookAtMatrixRH({0.0f, 0.0f, 0.0f}, {0.0f, 0.0f, -1.0f}, {0.0f, 1.0f, 0.0f}));
+    auto clipAt = [&](float x, float y, float z) {
+        return minity::clipBounds(sphere, multiplyMat4(viewProjection, translateMatrix(x, y, z)), -1.0f, 8.0f);
+    };
+    REQUIRE(clipAt(0.0f, 0.0f, -5.0f) == minity::kClipInside);
+    REQUIRE(clipAt(5.0f, 0.0f, -5.0f) == minity::kClipGuardBand); // half of it right of the screen
+    REQUIRE(clipAt(0.0f, 0.0f, 0.0f) == minity::kClipClipped); // around the camera
+    REQUIRE(clipAt(0.0f, 0.0f, -100.0f) == minity::kClipClipped); // at the far plane
+    REQUIRE(clipAt(0.0f, 0.0f, 5.0f) == minity::kClipRejected); // behind the camera
+    REQUIRE(clipAt(-8.0f, 0.0f, -5.0f) == minity::kClipRejected); // left of the screen
+    REQUIRE(clipAt(0.0f, 0.0f, -102.0f) == minity::kClipRejected); // behind the far plane
+    // the bounding sphere of a flat square crosses the far plane, its box does not
+    REQUIRE(minity::clipBounds(square, multiplyMat4(viewProjection, translateMatrix(0.0f, 0.0f, -100.5f)), -1.0f, 8.0f) == minity::kClipRejected);
+    REQUIRE(minity::clipBounds(square, multiplyMat4(viewProjection, translateMatrix(0.0f, 0.0f, -99.5f)), -1.0f, 8.0f) == minity::kClipInside);
+    // reversed-Z keeps the same volume
+    const mat4 reversed = multiplyMat4(perspectiveProjectionMatrix(90.0f, 1.0f, 0.1f, 100.0f, true),
+                                       translateMatrix(0.0f, 0.0f, -5.0f));
+    REQUIRE(minity::clipBounds(sphere, reversed, 0.0f, 8.0f) == minity::kClipInside);
+}
+
+TEST_CASE("faces are culled by the cull mode and the front face winding")
+{
+    // screen y grows down: right, then down is clockwise on the screen
+    const vec3 clockwise[3]{{0.0f, 0.0f, 0.5f}, {4.0f, 0.0f, 0.5f}, {0.0f, 4.0f, 0.5f}};
+    const vec3 counterClockwise[3]{{0.0f, 0.0f, 0.5f}, {0.0f, 4.0f, 0.5f}, {4.0f, 0.0f, 0.5f}};
+    const vec3 degenerate[3]{{0.0f, 0.0f, 0.5f}, {2.0f, 2.0f, 0.5f}, {4.0f, 4.0f, 0.5f}};
+    for (auto frontFace : {minity::kClockwise, minity::kCounterClockwise})
+    {
+        REQUIRE_FALSE(minity::isCulled(clockwise, minity::kCullNone, frontFace));
+        REQUIRE_FALSE(minity::isCulled(counterClockwise, minity::kCullNone, frontFace));
+        REQUIRE_FALSE(minity::isCulled(degenerate, minity::kCullNone, frontFace));
+        REQUIRE(minity::isCulled(degenerate, minity::kCullBack, frontFace));
+        REQUIRE(minity::isCulled(degenerate, minity::kCullFront, frontFace));
+    }
+    REQUIRE_FALSE(minity::isCulled(clockwise, minity::kCullBack, minity::kClockwise));
+    REQUIRE(minity::isCulled(counterClockwise, minity::kCullBack, minity::kClockwise));
+    REQUIRE(minity::isCulled(clockwise, minity::kCullFront, minity::kClockwise));
+    REQUIRE_FALSE(minity::isCulled(counterClockwise, minity::kCullFront, minity::kClockwise));
+    REQUIRE(minity::isCulled(clockwise, minity::kCullBack, minity::kCounterClockwise));
+    REQUIRE_FALSE(minity::isCulled(counterClockwise, minity::kCullBack, minity::kCounterClockwise));
+    REQUIRE_FALSE(minity::isCulled(clockwise, minity::kCullFront, minity::kCounterClockwise));
+    REQUIRE(minity::isCulled(counterClockwise, minity::kCullFront, minity::kCounterClockwise));
+}
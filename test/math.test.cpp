@@ -1,7 +1,9 @@
 #include <catch2/catch.hpp>
 #include <math.h>
+#include <array>
 #include <list>
 #include <utility>
+#include <chrono>
 #include <iostream>
 #include <stdexcept>
 
@@ -389,6 +391,20 @@ TEST_CASE("projection matrix - max x and y values when z at near plane")
     REQUIRE(vInClipSpace.z == -1.0f);
 }
 
+TEST_CASE("projection matrix - reversed z from one at near to zero at far plane")
+{
+    const mat4 projection = perspectiveProjectionMatrix(90.0f, 4.0f/3.0f, 1.0f, 3.0f, true);
+    printMat4(projection);
+    auto zInClipSpace = [&](float z) {
+        auto projected = multiplyVec3(vec3{0.0f, 0.0f, z}, projection);
+        return projected.z / projected.w;
+    };
+
+    REQUIRE(zInClipSpace(-1.0f) == 1.0f);
+    REQUIRE(zInClipSpace(-2.0f) == 0.25f); // the inverse of the midpoint above
+    REQUIRE(zInClipSpace(-3.0f) == 0.0f);
+}
+
 TEST_CASE("projection matrix - center with z at near plane")
 {
     const vec3 vInViewFrustum{0.0f, 0.0f, -1.0f};
@@ -754,6 +770,60 @@ TEST_CASE("pipeline with off-center camera right")
     REQUIRE(onScreen.y <= 480/2 + 1); // ~center with rounding error :-/
 }
 
+// a vertex stage projection one vec3 at a time with the scalar functions
+void projectScalar(const vec3 &position, const mat4 &m, float width, float height, vec3 &clip, vec3 &screen)
+{
+    clip = multiplyVec3(position, m);
+    screen = v3Div(clip, clip.w);
+    screen.x = (screen.x + 1.0f) * width / 2.0f;
+    screen.y = (1.0f - ((screen.y + 1.0f) / 2.0f)) * height;
+    screen.w = clip.w;
+}
+
+// positions interleaved with other vertex data, off the lane count
+std::vector<std::array<vec3, 2>> getBatchPositions(size_t count)
+{
+    std::vector<std::array<vec3, 2>> positions(count);
+    for (size_t i = 0; i < count; ++i)
+    {
+        const float angle = i * 0.1f;
+        positions[i][0] = vec3{std::cos(angle) * 5.0f, std::sin(angle) * 3.0f, -10.0f - i * 0.01f, i % 3 ? 1.0f : 0.5f};
+        positions[i][1] = vec3{99.0f, 99.0f, 99.0f}; // not a position
+    }
+    return positions;
+}
+
+TEST_CASE("batch transform matches multiplyVec3")
+{
+    const mat4 m = multiplyMat4(rotateYMatrix(0.3f), multiplyMat4(translateMatrix(1.0f, 2.0f, 3.0f), m2));
+    for (size_t count : {0, 1, 7, 8, 9, 37})
+    {
+        auto positions = getBatchPositions(count);
+        vec3SoA out;
+        transformPositions(&positions[0][0], count, sizeof(positions[0]), m, out);
+        REQUIRE(out.size() == count);
+        for (size_t i = 0; i < count; ++i)
+            REQUIRE(out.at(i) == multiplyVec3(positions[i][0], m));
+    }
+}
+
+TEST_CASE("batch projection matches the scalar divide and viewport mapping")
+{
+    const mat4 m = multiplyMat4(perspectiveProjectionMatrix(90.0f, 4.0f/3.0f, 0.1f, 100.0f),
+                                rotateXMatrix(0.2f));
+    const size_t count{37};
+    auto positions = getBatchPositions(count);
+    vec3SoA clip, screen;
+    projectPositions(&positions[0][0], count, sizeof(positions[0]), m, 640.0f, 480.0f, clip, screen);
+    for (size_t i = 0; i < count; ++i)
+    {
+        vec3 expectedClip, expectedScreen;
+        projectScalar(positions[i][0], m, 640.0f, 480.0f, expectedClip, expectedScreen);
+        REQUIRE(clip.at(i) == expectedClip);
+        REQUIRE(screen.at(i) == expectedScreen);
+    }
+}
+
 TEST_CASE("lookat camera matrix - simple")
 {
     // world point
@@ -946,3 +1016,34 @@ TEST_CASE("failing normal calculation")
     REQUIRE(std::isnan(normal.y));
     REQUIRE(std::isnan(normal.z));
 }
+
+TEST_CASE("benchmark - scalar vs batch projection of 1M vertices", "[.benchmark]")
+{
+    const size_t count{1000000};
+    const mat4 m = multiplyMat4(perspectiveProjectionMatrix(90.0f, 16.0f/9.0f, 0.1f, 100.0f),
+                                rotateXMatrix(0.2f));
+    auto positions = getBatchPositions(count);
+    std::vector<vec3> clip(count), screen(count);
+    vec3SoA clipSoA, screenSoA;
+
+    auto benchmark = [&](const std::string &name, auto project) {
+        using clock = std::chrono::steady_clock;
+        unsigned long int vertices{0};
+        auto start = clock::now();
+        std::chrono::duration<double> elapsed{0};
+        while (elapsed.count() < 1.0)
+        {
+            project();
+            vertices += count;
+            elapsed = clock::now() - start;
+        }
+        std::cout << name << ": " << vertices / elapsed.count() / 1.0e6 << " Mvertices/s" << std::endl;
+    };
+    benchmark("scalar multiplyVec3", [&]() {
+        for (size_t i = 0; i < count; ++i)
+            projectScalar(positions[i][0], m, 1920.0f, 1080.0f, clip[i], screen[i]);
+    });
+    benchmark("batch projectPositions", [&]() {
+        projectPositions(&positions[0][0], count, sizeof(positions[0]), m, 1920.0f, 1080.0f, clipSoA, screenSoA);
+    });
+}
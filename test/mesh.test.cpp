@@ -0,0 +1,23 @@
+#include <catch2/catch.hpp>
+#include <cmath>
+#include <memory>
+#include <vector>
+
+#define MATH_TYPES_ONLY
+#include "simpleMath.h"
+#include "mesh.h"
+
+TEST_CASE("mesh generators compute the bounds")
+{
+    auto sphere = minity::getSphereMesh(12, 6);
+    REQUIRE(sphere->bounds.valid);
+    REQUIRE(sphere->bounds.min.x == Approx(-1.0f));
+    REQUIRE(sphere->bounds.max.y == Approx(1.0f));
+    REQUIRE(sphere->bounds.radius == Approx(1.0f));
+    auto cube = minity::getCubeMesh();
+    REQUIRE(cube->bounds.valid);
+    REQUIRE(cube->bounds.min == vec3{-0.5f, -0.5f, -0.5f});
+    REQUIRE(cube->bounds.max == vec3{0.5f, 0.5f, 0.5f});
+    REQUIRE(cube->bounds.radius == Approx(std::sqrt(0.75f)));
+    REQUIRE_FALSE(minity::mesh{}.bounds.valid);
+}
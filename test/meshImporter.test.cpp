@@ -55,6 +55,23 @@ TEST_CASE("meshimporter - detailed hand-written model")
     }
 }
 
+TEST_CASE("meshimporter - computes the bounds of the model")
+{
+    std::string modelString = \
+    "v -1 0 2\n"
+    "v 0 3 2\n"
+    "v 1 0 -2\n"
+    "f 1 2 3\n";
+    minity::meshImporter importer;
+    auto mesh = importer.loadFromString(modelString);
+    REQUIRE(mesh->bounds.valid);
+    REQUIRE(mesh->bounds.min == vec3{-1.0f, 0.0f, -2.0f});
+    REQUIRE(mesh->bounds.max == vec3{1.0f, 3.0f, 2.0f});
+    REQUIRE(mesh->bounds.center == vec3{0.0f, 1.5f, 0.0f});
+    // all corners are sqrt(1 + 1.5 * 1.5 + 4) from the center
+    REQUIRE(mesh->bounds.radius == Approx(std::sqrt(7.25f)));
+}
+
 TEST_CASE("meshimporter - detailed hand-written model with normals")
 {
     std::string modelString = \
@@ -1,9 +1,14 @@
 #include <catch2/catch.hpp>
+#include <array>
+#include <chrono>
+#include <memory>
 
 #define MATH_TYPES_ONLY
 #include "simpleMath.h"
 #define MINITY_COLOR_TYPES_ONLY
 #include "color.h"
+#define MESH_UTILS_IMPLEMENTATION
+#include "mesh.h"
 #include "engine/software/rasterizer.h"
 
 const vec3 origin{0.0f, 0.0f, 0.0f};
@@ -114,12 +119,15 @@ TEST_CASE("draw line across the screen down")
     REQUIRE_THAT(db[2 + 0*3], Catch::Matchers::WithinRel(2.0f, 0.0000001f) );
 }
 
+// the two triangles below split the 3x3 viewport along the diagonal,
+// pixel centers on the diagonal belong only to the triangle where
+// it is a top or left edge (top-left fill rule)
 TEST_CASE("draw triangle top-left")
 {
     vec3 vertices[3]{
         {0.0f, 0.0f, 0.0f},
-        {0.0f, 2.0f, 0.0f},
-        {2.0f, 0.0f, 0.0f},
+        {0.0f, 3.0f, 0.0f},
+        {3.0f, 0.0f, 0.0f},
     };
     minity::rasterizer rasterizer(3,3);
     rasterizer.drawTriangle(vertices, minity::green);
@@ -132,9 +140,9 @@ TEST_CASE("draw triangle top-left")
     minity::color b = minity::black;
     minity::color g = minity::green;
     minity::color exp[9]{
-        g, g, g,
         g, g, b,
-        g, b, b
+        g, b, b,
+        b, b, b
     };
     printFramebuffer(exp, 3, 3);
     for (int i = 0; i < 9; ++i)
@@ -142,16 +150,17 @@ TEST_CASE("draw triangle top-left")
 
     auto db = rasterizer.getDepthbuffer();
     REQUIRE_THAT(db[0 + 0*3], Catch::Matchers::WithinRel(0.0f, 0.0000001f) );
-    REQUIRE_THAT(db[2 + 0*3], Catch::Matchers::WithinRel(0.0f, 0.0000001f) );
-    REQUIRE_THAT(db[0 + 2*3], Catch::Matchers::WithinRel(0.0f, 0.0000001f) );
+    REQUIRE_THAT(db[1 + 0*3], Catch::Matchers::WithinRel(0.0f, 0.0000001f) );
+    REQUIRE_THAT(db[0 + 1*3], Catch::Matchers::WithinRel(0.0f, 0.0000001f) );
+    REQUIRE(db[2 + 0*3] > 1000000); // +inf, on the bottom-right edge
 }
 
 TEST_CASE("draw triangle bottom-right")
 {
     vec3 vertices[3]{
-        {2.0f, 2.0f, 0.0f},
-        {0.0f, 2.0f, 0.0f},
-        {2.0f, 0.0f, 0.0f},
+        {3.0f, 3.0f, 0.0f},
+        {0.0f, 3.0f, 0.0f},
+        {3.0f, 0.0f, 0.0f},
     };
     minity::rasterizer rasterizer(3,3);
     rasterizer.drawTriangle(vertices, minity::green);
@@ -197,11 +206,48 @@ TEST_CASE("draw line bug - drawing does not stop")
     // }
 
     REQUIRE(fb[429 + 168*800] == minity::white);
-    REQUIRE(fb[427 + 165*800] == minity::white);
+    REQUIRE(fb[428 + 165*800] == minity::white); // ends at the pixel of to
+    REQUIRE(fb[427 + 165*800] == minity::black);
+
+    // the depth is interpolated, not truncated to -4
+    auto db = rasterizer.getDepthbuffer();
+    REQUIRE_THAT(db[429 + 168*800], Catch::Matchers::WithinRel(-4.037752f, 0.0000001f) );
+    REQUIRE_THAT(db[428 + 165*800], Catch::Matchers::WithinRel(-4.037769f, 0.0000001f) );
+}
+
+TEST_CASE("draw line keeps the depth order of fractional z")
+{
+    // with z truncated to integers 1.4 was drawn over 1.2
+    minity::rasterizer rasterizer(8, 8);
+    rasterizer.drawLine(vec3{0.0f, 3.0f, 1.2f}, vec3{7.0f, 3.0f, 1.2f}, minity::red);
+    rasterizer.drawLine(vec3{0.0f, 3.0f, 1.4f}, vec3{7.0f, 3.0f, 1.4f}, minity::blue);
+    auto fb = rasterizer.getFramebuffer();
+    for (int x = 0; x < 8; ++x)
+        REQUIRE(fb[x + 3*8] == minity::red);
+}
 
+TEST_CASE("draw line clips to the viewport")
+{
+    minity::rasterizer rasterizer(8, 4);
+    // horizontal, half outside on the left: z is interpolated to the edge
+    rasterizer.drawLine(vec3{-8.0f, 1.0f, 0.0f}, vec3{5.0f, 1.0f, 1.3f}, minity::white);
+    // through the viewport with both ends outside
+    rasterizer.drawLine(vec3{-1.5f, -1.0f, 0.0f}, vec3{10.5f, 11.0f, 0.0f}, minity::red);
+    // completely outside
+    rasterizer.drawLine(vec3{-1.0f, -1.0f, 0.0f}, vec3{20.0f, -1.0f, 0.0f}, minity::blue);
+    rasterizer.drawLine(vec3{8.0f, 0.0f, 0.0f}, vec3{8.0f, 3.0f, 0.0f}, minity::blue);
+    REQUIRE(rasterizer.stats.lines == 2);
+    REQUIRE(rasterizer.stats.xyClipped == 2);
+
+    auto fb = rasterizer.getFramebuffer();
     auto db = rasterizer.getDepthbuffer();
-    REQUIRE_THAT(db[429 + 168*800], Catch::Matchers::WithinRel(-4.0f, 0.0000001f) );
-    REQUIRE_THAT(db[427 + 165*800], Catch::Matchers::WithinRel(-4.0f, 0.0000001f) );
+    for (int x = 0; x < 8; ++x)
+        REQUIRE(fb[x + 1*8] == (x == 1 ? minity::red : x <= 5 ? minity::white : minity::black));
+    REQUIRE_THAT(db[0 + 1*8], Catch::Matchers::WithinRel(0.8f, 0.000001f));
+    REQUIRE_THAT(db[5 + 1*8], Catch::Matchers::WithinRel(1.3f, 0.000001f));
+    for (int i = 0; i < 4; ++i)
+        REQUIRE(fb[i + i*8] == minity::red);
+    REQUIRE(fb[0 + 0*8 + 7] == minity::black);
 }
 
 // WARNING: nan nan nan
@@ -240,3 +286,1647 @@ TEST_CASE("barycentric coordinates bug - degenerate triangle")
     REQUIRE(!std::isfinite(v)); // denominator becomes zero
     REQUIRE(!std::isfinite(w)); // denominator becomes zero
 }
+
+TEST_CASE("shared edges are drawn exactly once")
+{
+    // square split into a fan of four triangles around the center,
+    // both diagonals go exactly through pixel centers
+    vec3 c{4.0f, 4.0f, 0.0f};
+    vec3 corners[4]{{0.0f, 0.0f, 0.0f}, {8.0f, 0.0f, 0.0f}, {8.0f, 8.0f, 0.0f}, {0.0f, 8.0f, 0.0f}};
+    for (auto mode : {minity::kScalar, minity::kSimd, minity::kScanline})
+    {
+        minity::rasterizer rasterizer(10, 10);
+        rasterizer.setFillMode(mode);
+
+        int invocations{0};
+        auto countingShader = [&](float &u, float &v, float &w, minity::color color) -> minity::color
+        {
+            (void)u; (void)v; (void)w;
+            invocations++;
+            return color;
+        };
+        for (int i = 0; i < 4; ++i)
+        {
+            // alternate the winding, the fill rule must not depend on it
+            vec3 cw[3]{c, corners[i], corners[(i + 1) % 4]};
+            vec3 ccw[3]{c, corners[(i + 1) % 4], corners[i]};
+            rasterizer.drawTriangle(i % 2 ? cw : ccw, minity::green, countingShader);
+        }
+
+        auto fb = rasterizer.getFramebuffer();
+        for (int y = 0; y < 10; ++y)
+            for (int x = 0; x < 10; ++x)
+                REQUIRE(fb[x + y * 10] == (x < 8 && y < 8 ? minity::green : minity::black));
+        REQUIRE(invocations == 8 * 8); // no pixel shaded twice
+        REQUIRE(rasterizer.stats.inside == 8 * 8);
+    }
+}
+
+TEST_CASE("barycentric coordinates from edge functions")
+{
+    // z = 0 as barycentricCoordinates works in 3d
+    vec3 vertices[3]{
+        {1.0f, 1.0f, 0.0f},
+        {9.0f, 3.0f, 0.0f},
+        {2.0f, 8.0f, 0.0f},
+    };
+    minity::edgeFunctions edges{};
+    REQUIRE(edges.prepare(vertices));
+
+    minity::barycentricCoordinates bc{};
+    bc.prepare(vertices);
+    // pixel centers of pixels 3,3 2,6 and 7,3
+    for (vec3 point : {vec3{3.5f, 3.5f, 0.0f}, vec3{2.5f, 6.5f, 0.0f}, vec3{7.5f, 3.5f, 0.0f}})
+    {
+        float u, v, w;
+        bc.barycentricCoordinatesAt(vertices, point, u, v, w);
+        float eu, ev, ew;
+        edges.barycentricAt((int)point.x, (int)point.y, eu, ev, ew);
+        REQUIRE_THAT(eu, Catch::Matchers::WithinAbs(u, 1.0e-5f));
+        REQUIRE_THAT(ev, Catch::Matchers::WithinAbs(v, 1.0e-5f));
+        REQUIRE_THAT(ew, Catch::Matchers::WithinAbs(w, 1.0e-5f));
+    }
+}
+
+TEST_CASE("varyings interpolate perspective correct")
+{
+    const float values[3][2]{{0.0f, 1.0f}, {1.0f, 2.0f}, {0.0f, 3.0f}};
+    minity::varyings<2> attributes{};
+    float at[2];
+
+    // the same w everywhere is a plain linear interpolation
+    attributes.prepare(values, {2.0f, 2.0f, 2.0f});
+    attributes.at(0.25f, 0.5f, 0.25f, at);
+    REQUIRE_THAT(at[0], Catch::Matchers::WithinRel(0.5f, 1e-6f));
+    REQUIRE_THAT(at[1], Catch::Matchers::WithinRel(2.0f, 1e-6f));
+
+    // vertices keep their values, in between the nearer vertex weighs more
+    attributes.prepare(values, {1.0f, 4.0f, 2.0f});
+    attributes.at(0.0f, 1.0f, 0.0f, at);
+    REQUIRE_THAT(at[0], Catch::Matchers::WithinRel(1.0f, 1e-6f));
+    REQUIRE_THAT(at[1], Catch::Matchers::WithinRel(2.0f, 1e-6f));
+    attributes.at(0.5f, 0.5f, 0.0f, at);
+    // (0 / 1 + 1 / 4) / (1 / 1 + 1 / 4) = 0.2
+    REQUIRE_THAT(at[0], Catch::Matchers::WithinRel(0.2f, 1e-6f));
+    REQUIRE_THAT(at[1], Catch::Matchers::WithinRel(1.2f, 1e-6f));
+    REQUIRE_THAT(attributes.overWAt(1, 0.5f, 0.5f, 0.0f) * attributes.perspective(0.5f, 0.5f, 0.0f), Catch::Matchers::WithinRel(1.2f, 1e-6f));
+}
+
+TEST_CASE("degenerate triangle is skipped")
+{
+    vec3 vertices[3]{
+        {1.0f, 1.0f, 0.0f},
+        {2.0f, 2.0f, 0.0f},
+        {3.0f, 3.0f, 0.0f},
+    };
+    minity::rasterizer rasterizer(4, 4);
+    rasterizer.drawTriangle(vertices, minity::green);
+    REQUIRE(rasterizer.stats.degenerate == 1);
+    REQUIRE(rasterizer.stats.inside == 0);
+}
+
+// screen space triangles of the default minity scene:
+// a unit sphere 3 units in front of the camera with 50 degree fov
+std::vector<std::array<vec3, 3>> getSphereScene(size_t meridians, size_t parallels, unsigned int width, unsigned int height, bool reversedZ = false)
+{
+    auto mesh = minity::getSphereMesh(meridians, parallels);
+    mat4 modelMatrix = translateMatrix(0.0f, 0.0f, 2.0f);
+    mat4 viewMatrix = lookAtMatrixRH(vec3{0.0f, 0.0f, 5.0f}, vec3{0.0f, 0.0f, 0.0f}, vec3{0.0f, 1.0f, 0.0f});
+    mat4 projectionMatrix = perspectiveProjectionMatrix(50.0f, (float)width / (float)height, 0.1f, 400.0f, reversedZ);
+    mat4 mvp = multiplyMat4(projectionMatrix, multiplyMat4(viewMatrix, modelMatrix));
+
+    std::vector<std::array<vec3, 3>> triangles{};
+    for (size_t i = 0; i < mesh->indexData.size(); i += 3)
+    {
+        std::array<vec3, 3> triangle{};
+        for (int idx : {0, 1, 2})
+        {
+            vec3 clip = multiplyVec3(mesh->vertexData[mesh->indexData[i + idx]].position, mvp);
+            vec3 ndc{clip.x / clip.w, clip.y / clip.w, clip.z / clip.w};
+            triangle[idx] = vec3{
+                (ndc.x + 1.0f) * static_cast<float>(width) / 2.0f,
+                (1.0f - ((ndc.y + 1.0f) / 2.0f)) * static_cast<float>(height),
+                ndc.z};
+        }
+        triangles.push_back(triangle);
+    }
+    return triangles;
+}
+
+// shades the barycentric coordinates to colors to catch
+// any difference in what the fragment shader gets
+auto barycentricShader = [](float &u, float &v, float &w, minity::color color) -> minity::color
+{
+    (void)color;
+    return ((minity::color)(u * 255.0f) << 24) | ((minity::color)(v * 255.0f) << 16) | ((minity::color)(w * 255.0f) << 8) | 0xff;
+};
+
+TEST_CASE("drawLines draws the same as drawLine")
+{
+    const unsigned int width{320};
+    const unsigned int height{240};
+    auto triangles = getSphereScene(60, 30, width, height);
+    std::vector<std::array<vec3, 2>> lines{};
+    for (auto &t : triangles)
+        for (int i : {0, 1, 2})
+            lines.push_back({t[i], t[(i + 1) % 3]});
+
+    minity::rasterizer reference(width, height);
+    for (auto &line : lines)
+        reference.drawLine(line[0], line[1], minity::gray50);
+
+    for (bool binning : {false, true})
+    {
+        minity::rasterizer rasterizer(width, height);
+        rasterizer.setBinning(binning, 4);
+        rasterizer.drawLines(lines.data(), lines.size(), minity::gray50);
+        REQUIRE(rasterizer.stats.lines == reference.stats.lines);
+        REQUIRE(std::equal(rasterizer.getFramebuffer(), rasterizer.getFramebuffer() + width * height, reference.getFramebuffer()));
+        REQUIRE(std::equal(rasterizer.getDepthbuffer(), rasterizer.getDepthbuffer() + width * height, reference.getDepthbuffer()));
+    }
+}
+
+TEST_CASE("binned rendering keeps the triangle order inside a tile")
+{
+    // same depth, so the later triangle wins the z-check
+    vec3 first[3]{{0.0f, 0.0f, 0.0f}, {100.0f, 0.0f, 0.0f}, {0.0f, 100.0f, 0.0f}};
+    vec3 second[3]{{10.0f, 10.0f, 0.0f}, {90.0f, 10.0f, 0.0f}, {10.0f, 90.0f, 0.0f}};
+    minity::rasterizer rasterizer(100, 100);
+    rasterizer.setBinning(true, 4);
+    for (int i = 0; i < 10; ++i)
+    {
+        rasterizer.drawTriangle(first, minity::red);
+        rasterizer.drawTriangle(second, minity::green);
+    }
+    rasterizer.drawPoint(vec3{20.0f, 20.0f, 0.0f}, minity::white);
+    auto fb = rasterizer.getFramebuffer();
+    REQUIRE(fb[5 + 5 * 100] == minity::red);
+    REQUIRE(fb[30 + 30 * 100] == minity::green);
+    REQUIRE(fb[70 + 10 * 100] == minity::green); // across the 64 pixel tile border
+    REQUIRE(fb[20 + 20 * 100] == minity::white); // points and lines after the triangles
+    REQUIRE(rasterizer.stats.triangles == 20);
+}
+
+TEST_CASE("binned rendering is deterministic for any number of threads")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    auto triangles = getSphereScene(60, 30, width, height);
+
+    auto render = [&](bool binning, unsigned int threads) {
+        auto rasterizer = std::make_unique<minity::rasterizer>(width, height);
+        rasterizer->setBinning(binning, threads);
+        for (auto &t : triangles)
+            rasterizer->drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+        rasterizer->finishFrame();
+        return rasterizer;
+    };
+
+    auto reference = render(true, 1);
+    REQUIRE(reference->stats.inside > 0);
+    for (unsigned int threads : {2u, 3u, 8u})
+    {
+        auto binned = render(true, threads);
+        REQUIRE(binned->stats.inside == reference->stats.inside);
+        REQUIRE(binned->stats.points == reference->stats.points);
+        REQUIRE(std::equal(binned->getFramebuffer(), binned->getFramebuffer() + width * height, reference->getFramebuffer()));
+        REQUIRE(std::equal(binned->getDepthbuffer(), binned->getDepthbuffer() + width * height, reference->getDepthbuffer()));
+    }
+}
+
+TEST_CASE("sort-last rendering matches the direct rendering")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    for (auto format : {minity::kDepthFloat, minity::kDepthReversedFloat, minity::kDepthUnorm24, minity::kDepthUnorm16})
+    {
+        const bool reversedZ = format == minity::kDepthReversedFloat;
+        const float z = reversedZ ? 0.01f : 0.99f;
+        // a red and a green background at the same depth in the first and
+        // the last slice, the later one wins the tie in every pixel
+        std::vector<std::array<vec3, 3>> triangles{
+            {vec3{0.0f, 0.0f, z}, vec3{(float)width, 0.0f, z}, vec3{0.0f, (float)height, z}},
+            {vec3{(float)width, 0.0f, z}, vec3{(float)width, (float)height, z}, vec3{0.0f, (float)height, z}}};
+        for (auto &t : getSphereScene(60, 30, width, height, reversedZ))
+            triangles.push_back(t);
+        triangles.push_back(triangles[0]);
+        triangles.push_back(triangles[1]);
+
+        for (bool tiled : {false, true})
+        {
+            auto render = [&](bool sortLast, unsigned int threads) {
+                auto rasterizer = std::make_unique<minity::rasterizer>(width, height);
+                rasterizer->setDepthFormat(format);
+                rasterizer->setTiledLayout(tiled);
+                rasterizer->setSortLast(sortLast, threads);
+                for (size_t i = 0; i < triangles.size(); ++i)
+                {
+                    const minity::color color = i < 2 ? minity::red : minity::green;
+                    const vec3 vertices[3]{triangles[i][0], triangles[i][1], triangles[i][2]};
+                    if (i < 2 || i >= triangles.size() - 2)
+                        rasterizer->drawTriangle(vertices, color);
+                    else
+                        rasterizer->drawTriangle(vertices, color, barycentricShader);
+                }
+                rasterizer->drawPoint(vec3{320.0f, 240.0f, reversedZ ? 1.0f : -1.0f}, minity::red);
+                rasterizer->finishFrame();
+                return rasterizer;
+            };
+
+            auto reference = render(false, 1);
+            REQUIRE(reference->getFramebuffer()[0] == minity::green);
+            REQUIRE(reference->getFramebuffer()[320 + 240 * width] == minity::red);
+            for (unsigned int threads : {1u, 3u, 4u})
+            {
+                auto sortLast = render(true, threads);
+                REQUIRE(sortLast->isSortLast());
+                REQUIRE(sortLast->stats.triangles == reference->stats.triangles);
+                REQUIRE(std::equal(sortLast->getFramebuffer(), sortLast->getFramebuffer() + width * height, reference->getFramebuffer()));
+                REQUIRE(std::equal(sortLast->getDepthbuffer(), sortLast->getDepthbuffer() + width * height, reference->getDepthbuffer()));
+            }
+        }
+    }
+}
+
+TEST_CASE("sort-last rendering with a depth prepass matches the direct rendering")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    for (auto format : {minity::kDepthFloat, minity::kDepthReversedFloat, minity::kDepthUnorm24, minity::kDepthUnorm16})
+    {
+        auto triangles = getSphereScene(60, 30, width, height, format == minity::kDepthReversedFloat);
+        for (bool tiled : {false, true})
+        {
+            // both passes in one frame, the equal pass needs the depth of all slices,
+            // the modes are set after the sort-last mode and passed to the slices
+            auto render = [&](bool sortLast, unsigned int threads) {
+                auto rasterizer = std::make_unique<minity::rasterizer>(width, height);
+                rasterizer->setSortLast(sortLast, threads);
+                rasterizer->setDepthFormat(format);
+                rasterizer->setTiledLayout(tiled);
+                for (auto &t : triangles)
+                    rasterizer->drawTriangle({t[0], t[1], t[2]}, minity::yellow, minity::nullShader, minity::kDepthOnly);
+                for (auto &t : triangles)
+                    rasterizer->drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader, minity::kEqualDepth);
+                rasterizer->finishFrame();
+                return rasterizer;
+            };
+
+            auto reference = render(false, 1);
+            REQUIRE(reference->stats.shaded > 0);
+            for (unsigned int threads : {1u, 3u, 4u})
+            {
+                auto sortLast = render(true, threads);
+                REQUIRE(sortLast->isSortLast());
+                REQUIRE(sortLast->stats.shaded == reference->stats.shaded);
+                REQUIRE(std::equal(sortLast->getFramebuffer(), sortLast->getFramebuffer() + width * height, reference->getFramebuffer()));
+                REQUIRE(std::equal(sortLast->getDepthbuffer(), sortLast->getDepthbuffer() + width * height, reference->getDepthbuffer()));
+            }
+        }
+    }
+}
+
+TEST_CASE("sort-last rendering keeps the color under depth only triangles")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    SECTION("a depth only triangle in front of a colored one") {
+        vec3 colored[3]{{0.0f, 0.0f, 0.9f}, {64.0f, 0.0f, 0.9f}, {0.0f, 64.0f, 0.9f}};
+        vec3 nearer[3]{{0.0f, 0.0f, 0.1f}, {64.0f, 0.0f, 0.1f}, {0.0f, 64.0f, 0.1f}};
+        minity::rasterizer rasterizer(64, 64);
+        rasterizer.setSortLast(true, 2);
+        rasterizer.drawTriangle(colored, minity::red);
+        rasterizer.drawTriangle(nearer, minity::green, minity::nullShader, minity::kDepthOnly);
+        REQUIRE(rasterizer.getFramebuffer()[0] == minity::red);
+        REQUIRE(rasterizer.getDepthbuffer()[0] == Approx(0.1f));
+    }
+    SECTION("colored and depth only triangles mixed in one frame") {
+        for (auto format : {minity::kDepthFloat, minity::kDepthReversedFloat, minity::kDepthUnorm24, minity::kDepthUnorm16})
+        {
+            auto triangles = getSphereScene(20, 10, width, height, format == minity::kDepthReversedFloat);
+            for (bool tiled : {false, true})
+            {
+                // every other triangle of the sphere only writes the depth
+                auto render = [&](bool sortLast, unsigned int threads) {
+                    auto rasterizer = std::make_unique<minity::rasterizer>(width, height);
+                    rasterizer->setDepthFormat(format);
+                    rasterizer->setTiledLayout(tiled);
+                    rasterizer->setSortLast(sortLast, threads);
+                    for (size_t i = 0; i < triangles.size(); ++i)
+                    {
+                        const vec3 vertices[3]{triangles[i][0], triangles[i][1], triangles[i][2]};
+                        if (i % 2)
+                            rasterizer->drawTriangle(vertices, minity::yellow, minity::nullShader, minity::kDepthOnly);
+                        else
+                            rasterizer->drawTriangle(vertices, minity::yellow, barycentricShader);
+                    }
+                    rasterizer->finishFrame();
+                    return rasterizer;
+                };
+
+                auto reference = render(false, 1);
+                for (unsigned int threads : {1u, 3u, 4u})
+                {
+                    auto sortLast = render(true, threads);
+                    REQUIRE(std::equal(sortLast->getFramebuffer(), sortLast->getFramebuffer() + width * height, reference->getFramebuffer()));
+                    REQUIRE(std::equal(sortLast->getDepthbuffer(), sortLast->getDepthbuffer() + width * height, reference->getDepthbuffer()));
+                }
+            }
+        }
+    }
+}
+
+TEST_CASE("ordered depth keeps the order of the stored values")
+{
+    const float values[]{-std::numeric_limits<float>::infinity(), -1.0f, -0.5f, 0.0f, 1e-20f, 0.5f, 1.0f, std::numeric_limits<float>::infinity()};
+    for (size_t i = 0; i + 1 < sizeof(values) / sizeof(values[0]); ++i)
+    {
+        REQUIRE(minity::depthTraits<minity::kDepthFloat>::ordered(values[i]) < minity::depthTraits<minity::kDepthFloat>::ordered(values[i + 1]));
+        REQUIRE(minity::depthTraits<minity::kDepthReversedFloat>::ordered(values[i]) > minity::depthTraits<minity::kDepthReversedFloat>::ordered(values[i + 1]));
+    }
+    for (float value : values)
+        REQUIRE(minity::depthTraits<minity::kDepthFloat>::fromOrdered(minity::depthTraits<minity::kDepthFloat>::ordered(value)) == value);
+    REQUIRE(minity::depthTraits<minity::kDepthUnorm16>::ordered(0xffff) == 0xffff);
+}
+
+TEST_CASE("unordered rendering matches the direct rendering of opaque geometry")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    for (auto format : {minity::kDepthFloat, minity::kDepthReversedFloat, minity::kDepthUnorm24, minity::kDepthUnorm16})
+    {
+        auto triangles = getSphereScene(60, 30, width, height, format == minity::kDepthReversedFloat);
+        for (bool tiled : {false, true})
+        {
+            // the packed fill steps along the spans like the scanline fill
+            auto render = [&](bool unordered, unsigned int threads, bool prepass) {
+                auto rasterizer = std::make_unique<minity::rasterizer>(width, height);
+                rasterizer->setFillMode(minity::kScanline);
+                rasterizer->setDepthFormat(format);
+                rasterizer->setTiledLayout(tiled);
+                rasterizer->setUnordered(unordered, threads);
+                if (prepass)
+                {
+                    for (auto &t : triangles)
+                        rasterizer->drawTriangle({t[0], t[1], t[2]}, minity::yellow, minity::nullShader, minity::kDepthOnly);
+                    rasterizer->finishFrame(); // the depth has to be complete
+                }
+                for (auto &t : triangles)
+                    rasterizer->drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader,
+                        prepass ? minity::kEqualDepth : minity::kEarlyDepthTest);
+                rasterizer->finishFrame();
+                return rasterizer;
+            };
+
+            auto reference = render(false, 1, false);
+            for (unsigned int threads : {1u, 3u, 4u})
+                for (bool prepass : {false, true})
+                {
+                    auto unordered = render(true, threads, prepass);
+                    REQUIRE(unordered->isUnordered());
+                    REQUIRE(std::equal(unordered->getFramebuffer(), unordered->getFramebuffer() + width * height, reference->getFramebuffer()));
+                    REQUIRE(std::equal(unordered->getDepthbuffer(), unordered->getDepthbuffer() + width * height, reference->getDepthbuffer()));
+                    if (prepass)
+                        REQUIRE(unordered->stats.shaded == unordered->stats.points);
+                }
+        }
+    }
+}
+
+TEST_CASE("unordered rendering resolves equal depth to the smaller color")
+{
+    vec3 first[3]{{0.0f, 0.0f, 0.5f}, {16.0f, 0.0f, 0.5f}, {0.0f, 16.0f, 0.5f}};
+    vec3 second[3]{{0.0f, 0.0f, 0.5f}, {16.0f, 0.0f, 0.5f}, {0.0f, 16.0f, 0.5f}};
+    for (bool redFirst : {false, true})
+    {
+        minity::rasterizer rasterizer(16, 16);
+        rasterizer.setUnordered(true, 2);
+        rasterizer.drawTriangle(first, redFirst ? minity::red : minity::blue);
+        rasterizer.drawTriangle(second, redFirst ? minity::blue : minity::red);
+        // drawn on top of what is in the buffers
+        rasterizer.finishFrame();
+        rasterizer.drawTriangle({{0.0f, 0.0f, 0.2f}, {4.0f, 0.0f, 0.2f}, {0.0f, 4.0f, 0.2f}}, minity::green);
+        REQUIRE(rasterizer.getFramebuffer()[1 + 1 * 16] == minity::green);
+        REQUIRE(rasterizer.getFramebuffer()[5 + 5 * 16] == std::min(minity::red, minity::blue));
+        REQUIRE(rasterizer.getFramebuffer()[15 + 15 * 16] == minity::black);
+    }
+}
+
+TEST_CASE("simd fill matches the scalar fill")
+{
+    // odd sizes so that rows end in partially filled vectors
+    const unsigned int width{37};
+    const unsigned int height{23};
+    vec3 back[3]{{0.0f, 0.0f, 0.5f}, {37.0f, 0.0f, 0.5f}, {0.0f, 23.0f, 0.5f}};
+    vec3 front[3]{{3.0f, 2.0f, 0.0f}, {35.0f, 20.0f, 0.0f}, {1.0f, 21.0f, 0.0f}};
+
+    auto render = [&](minity::fillMode mode) {
+        auto rasterizer = std::make_unique<minity::rasterizer>(width, height);
+        rasterizer->setFillMode(mode);
+        rasterizer->drawTriangle(back, minity::red);
+        rasterizer->drawTriangle(front, minity::green);
+        rasterizer->drawTriangle(back, minity::blue); // behind the front triangle
+        return rasterizer;
+    };
+
+    auto scalar = render(minity::kScalar);
+    auto simd = render(minity::kSimd);
+    REQUIRE(simd->stats.inside == scalar->stats.inside);
+    REQUIRE(simd->stats.outside == scalar->stats.outside);
+    REQUIRE(simd->stats.points == scalar->stats.points);
+    REQUIRE(simd->stats.depth == scalar->stats.depth);
+    REQUIRE(std::equal(simd->getFramebuffer(), simd->getFramebuffer() + width * height, scalar->getFramebuffer()));
+    REQUIRE(std::equal(simd->getDepthbuffer(), simd->getDepthbuffer() + width * height, scalar->getDepthbuffer()));
+}
+
+TEST_CASE("fixed point rasterization is bit exact across fill modes and threads")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    auto triangles = getSphereScene(60, 30, width, height);
+
+    auto render = [&](minity::fillMode mode, bool binning, unsigned int threads) {
+        auto rasterizer = std::make_unique<minity::rasterizer>(width, height);
+        rasterizer->setFillMode(mode);
+        rasterizer->setBinning(binning, threads);
+        for (auto &t : triangles)
+            rasterizer->drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+        rasterizer->finishFrame();
+        return rasterizer;
+    };
+
+    auto reference = render(minity::kScalar, false, 1);
+    REQUIRE(reference->stats.inside > 0);
+    for (auto mode : {minity::kScalar, minity::kSimd})
+    {
+        for (unsigned int threads : {0u, 1u, 3u})
+        {
+            auto other = render(mode, threads > 0, threads);
+            REQUIRE(other->stats.inside == reference->stats.inside);
+            REQUIRE(other->stats.points == reference->stats.points);
+            REQUIRE(std::equal(other->getFramebuffer(), other->getFramebuffer() + width * height, reference->getFramebuffer()));
+            REQUIRE(std::equal(other->getDepthbuffer(), other->getDepthbuffer() + width * height, reference->getDepthbuffer()));
+        }
+    }
+}
+
+TEST_CASE("scanline fill covers the same pixels as the block fill")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    auto triangles = getSphereScene(60, 30, width, height);
+    // slivers with large, mostly empty bounding boxes and clipped ones
+    triangles.push_back({vec3{-20.0f, 10.0f, 0.1f}, vec3{660.0f, 12.5f, 0.1f}, vec3{300.0f, 11.0f, 0.1f}});
+    triangles.push_back({vec3{5.5f, -10.0f, 0.1f}, vec3{7.0f, 500.0f, 0.1f}, vec3{6.25f, 240.0f, 0.1f}});
+    triangles.push_back({vec3{600.0f, 400.0f, 0.1f}, vec3{700.0f, 450.0f, 0.2f}, vec3{620.0f, 520.0f, 0.3f}});
+
+    auto render = [&](minity::fillMode mode, bool binning, auto shader) {
+        auto rasterizer = std::make_unique<minity::rasterizer>(width, height);
+        rasterizer->setFillMode(mode);
+        rasterizer->setBinning(binning, 3);
+        for (auto &t : triangles)
+            rasterizer->drawTriangle({t[0], t[1], t[2]}, minity::yellow, shader);
+        rasterizer->finishFrame();
+        return rasterizer;
+    };
+    auto flatShader = [](float &u, float &v, float &w, minity::color color) { (void)u; (void)v; (void)w; return color; };
+
+    for (bool binning : {false, true})
+    {
+        // coverage and depth test results are exact, the scanlines
+        // also test the pixels of blocks the hierarchical z rejects
+        auto blocks = render(minity::kScalar, false, flatShader);
+        auto scanline = render(minity::kScanline, binning, flatShader);
+        REQUIRE(scanline->stats.points == blocks->stats.points);
+        REQUIRE(scanline->stats.inside > blocks->stats.inside);
+        REQUIRE(scanline->stats.blocksDepthRejected == 0);
+        REQUIRE(std::equal(scanline->getFramebuffer(), scanline->getFramebuffer() + width * height, blocks->getFramebuffer()));
+
+        // depth and the barycentric coordinates are stepped along the spans,
+        // so they differ by float rounding only
+        blocks = render(minity::kScalar, false, barycentricShader);
+        scanline = render(minity::kScanline, binning, barycentricShader);
+        const minity::color *expected = blocks->getFramebuffer();
+        const minity::color *actual = scanline->getFramebuffer();
+        const float *expectedDepth = blocks->getDepthbuffer();
+        const float *actualDepth = scanline->getDepthbuffer();
+        size_t wrong{0};
+        for (unsigned int i = 0; i < width * height; ++i)
+        {
+            for (int shift : {8, 16, 24})
+                if (std::abs((int)((expected[i] >> shift) & 0xff) - (int)((actual[i] >> shift) & 0xff)) > 1)
+                    wrong++;
+            if (std::isfinite(expectedDepth[i]) && std::fabs(actualDepth[i] - expectedDepth[i]) > 1e-5f)
+                wrong++;
+        }
+        REQUIRE(wrong == 0);
+    }
+}
+
+TEST_CASE("vertices are snapped to the sub-pixel grid")
+{
+    // less than half a sub-pixel apart, both snap to the same 1/256 pixel grid point
+    vec3 a[3]{{0.5f, 0.5f, 0.0f}, {8.5f, 0.5f, 0.0f}, {0.5f, 8.5f, 0.0f}};
+    vec3 b[3]{{0.5f + 1.0f / 1024.0f, 0.5f, 0.0f}, {8.5f, 0.5f - 1.0f / 1024.0f, 0.0f}, {0.5f, 8.5f, 0.0f}};
+    minity::edgeFunctions ea{};
+    minity::edgeFunctions eb{};
+    REQUIRE(ea.prepare(a));
+    REQUIRE(eb.prepare(b));
+    for (int i : {0, 1, 2})
+    {
+        REQUIRE(ea.a[i] == eb.a[i]);
+        REQUIRE(ea.b[i] == eb.b[i]);
+        REQUIRE(ea.c[i] == eb.c[i]);
+    }
+
+    // a sliver thinner than the sub-pixel grid collapses
+    vec3 sliver[3]{{0.0f, 0.0f, 0.0f}, {100.0f, 0.001f, 0.0f}, {50.0f, 0.0005f, 0.0f}};
+    minity::edgeFunctions es{};
+    REQUIRE_FALSE(es.prepare(sliver));
+}
+
+TEST_CASE("blocks are rejected, accepted or tested pixel by pixel")
+{
+    // the hypotenuse x + y = 64 cuts the 8x8 blocks diagonally:
+    // blocks with bx + by < 7 are inside, bx + by == 7 are cut and
+    // the rest are outside
+    vec3 v[3]{{0.0f, 0.0f, 0.0f}, {64.0f, 0.0f, 0.0f}, {0.0f, 64.0f, 0.0f}};
+    for (auto mode : {minity::kScalar, minity::kSimd})
+    {
+        minity::rasterizer rasterizer(64, 64);
+        rasterizer.setFillMode(mode);
+        rasterizer.drawTriangle(v, minity::green);
+        REQUIRE(rasterizer.stats.blocksAccepted == 28);
+        REQUIRE(rasterizer.stats.blocksPartial == 8);
+        REQUIRE(rasterizer.stats.blocksRejected == 28);
+        // pixel centers on the hypotenuse (a bottom-right edge) are not drawn
+        REQUIRE(rasterizer.stats.inside == 63 * 64 / 2);
+        REQUIRE(rasterizer.stats.outside == 8 * (64 - 28));
+        auto fb = rasterizer.getFramebuffer();
+        for (int y = 0; y < 64; ++y)
+            for (int x = 0; x < 64; ++x)
+                if (fb[x + y * 64] != (x + y < 63 ? minity::green : minity::black))
+                    FAIL("pixel " << x << "," << y);
+    }
+}
+
+// the block walk of plotTriangle without the small triangle fast paths
+template <typename Shader>
+void fillWithBlocks(const vec3 (&vertices)[3], minity::rasterizer &rasterizer, Shader shader)
+{
+    minity::tile bounds{};
+    minity::edgeFunctions edges{};
+    const minity::tile viewport{0, 0, (int)rasterizer.getViewportWidth() - 1, (int)rasterizer.getViewportHeight() - 1};
+    if (minity::triangleBounds(vertices, viewport, bounds) && edges.prepare(vertices))
+        minity::fillBlocks<Shader, kRasterizerStats, minity::kDepthFloat>(vertices, minity::yellow, &rasterizer, shader, minity::kEarlyDepthTest, edges, bounds, rasterizer.stats);
+}
+
+TEST_CASE("small triangles take the fast paths")
+{
+    minity::rasterizer rasterizer(16, 16);
+    // between the pixel centers
+    rasterizer.drawTriangle({{0.6f, 0.6f, 0.0f}, {1.4f, 0.6f, 0.0f}, {0.6f, 1.4f, 0.0f}}, minity::red);
+    REQUIRE(rasterizer.stats.culled == 1);
+    rasterizer.drawTriangle({{0.0f, 0.0f, 0.0f}, {1.9f, 0.0f, 0.0f}, {0.0f, 1.9f, 0.0f}}, minity::red);
+    REQUIRE(rasterizer.stats.tiny == 1);
+    rasterizer.drawTriangle({{4.0f, 4.0f, 0.0f}, {7.9f, 4.0f, 0.0f}, {4.0f, 7.9f, 0.0f}}, minity::red);
+    REQUIRE(rasterizer.stats.small == 1);
+    rasterizer.drawTriangle({{8.0f, 8.0f, 0.0f}, {12.0f, 8.0f, 0.0f}, {8.0f, 12.0f, 0.0f}}, minity::red);
+    REQUIRE(rasterizer.stats.triangles == 4);
+    REQUIRE(rasterizer.stats.culled + rasterizer.stats.tiny + rasterizer.stats.small == 3);
+    REQUIRE(rasterizer.stats.blocksPartial > 0);
+}
+
+TEST_CASE("small triangle fast paths draw the same as the block walk")
+{
+    const unsigned int width{320};
+    const unsigned int height{240};
+    auto triangles = getSphereScene(256, 128, width, height);
+
+    minity::rasterizer fast(width, height);
+    minity::rasterizer blocks(width, height);
+    for (auto &t : triangles)
+    {
+        const vec3 vertices[3]{t[0], t[1], t[2]};
+        fast.drawTriangle(vertices, minity::yellow, barycentricShader);
+        fillWithBlocks(vertices, blocks, barycentricShader);
+    }
+    REQUIRE(fast.stats.tiny > 0);
+    REQUIRE(fast.stats.small > 0);
+    REQUIRE(fast.stats.culled > 0);
+    REQUIRE(fast.stats.points == blocks.stats.points);
+    REQUIRE(std::equal(fast.getFramebuffer(), fast.getFramebuffer() + width * height, blocks.getFramebuffer()));
+    REQUIRE(std::equal(fast.getDepthbuffer(), fast.getDepthbuffer() + width * height, blocks.getDepthbuffer()));
+}
+
+TEST_CASE("blocks behind the drawn depth are rejected")
+{
+    // the occluder covers the left half, 4 x 8 blocks
+    vec3 occluder1[3]{{0.0f, 0.0f, 0.2f}, {32.0f, 0.0f, 0.2f}, {0.0f, 64.0f, 0.2f}};
+    vec3 occluder2[3]{{32.0f, 0.0f, 0.2f}, {32.0f, 64.0f, 0.2f}, {0.0f, 64.0f, 0.2f}};
+    vec3 behind1[3]{{0.0f, 0.0f, 0.6f}, {64.0f, 0.0f, 0.6f}, {0.0f, 64.0f, 0.6f}};
+    vec3 behind2[3]{{64.0f, 0.0f, 0.6f}, {64.0f, 64.0f, 0.6f}, {0.0f, 64.0f, 0.6f}};
+    for (auto mode : {minity::kScalar, minity::kSimd})
+    {
+        minity::rasterizer rasterizer(64, 64);
+        rasterizer.setFillMode(mode);
+        rasterizer.drawTriangle(occluder1, minity::green);
+        rasterizer.drawTriangle(occluder2, minity::green);
+        REQUIRE(rasterizer.blockDepthAt(0, 0) == Approx(0.2f));
+        REQUIRE(rasterizer.blockDepthAt(63, 63) == std::numeric_limits<float>::infinity());
+
+        rasterizer.stats = rasterizerStats{};
+        rasterizer.drawTriangle(behind1, minity::red);
+        rasterizer.drawTriangle(behind2, minity::red);
+        // 4 x 8 blocks, the 4 on the diagonal are tested for both triangles
+        REQUIRE(rasterizer.stats.blocksDepthRejected == 36);
+        REQUIRE(rasterizer.stats.inside == 32 * 64); // only the right half is tested
+        REQUIRE(rasterizer.stats.depth == 0);
+        auto fb = rasterizer.getFramebuffer();
+        REQUIRE(fb[10 + 10 * 64] == minity::green);
+        REQUIRE(fb[50 + 10 * 64] == minity::red);
+        REQUIRE(rasterizer.blockDepthAt(63, 63) == Approx(0.6f));
+    }
+}
+
+TEST_CASE("early depth test skips the shader for occluded pixels")
+{
+    // the front triangle covers blocks only partially,
+    // so the hierarchical z can not reject the back one
+    vec3 front[3]{{4.0f, 4.0f, 0.2f}, {60.0f, 4.0f, 0.2f}, {4.0f, 60.0f, 0.2f}};
+    vec3 back[3]{{0.0f, 0.0f, 0.6f}, {64.0f, 0.0f, 0.6f}, {0.0f, 64.0f, 0.6f}};
+    for (auto mode : {minity::kScalar, minity::kSimd, minity::kScanline})
+    {
+        unsigned long int calls{0};
+        auto countingShader = [&calls](float &u, float &v, float &w, minity::color color) -> minity::color {
+            (void)u; (void)v; (void)w;
+            calls++;
+            return color;
+        };
+
+        minity::rasterizer early(64, 64);
+        early.setFillMode(mode);
+        early.drawTriangle(front, minity::green);
+        early.stats = rasterizerStats{};
+        early.drawTriangle(back, minity::red, countingShader);
+        REQUIRE(early.stats.depth > 0);
+        REQUIRE(calls == early.stats.points);
+        REQUIRE(early.stats.shaded == early.stats.points);
+        REQUIRE(early.stats.shaded + early.stats.depth == early.stats.inside);
+
+        calls = 0;
+        minity::rasterizer late(64, 64);
+        late.setFillMode(mode);
+        late.drawTriangle(front, minity::green);
+        late.stats = rasterizerStats{};
+        late.drawTriangle(back, minity::red, countingShader, minity::kLateDepthTest);
+        REQUIRE(calls == late.stats.inside);
+        REQUIRE(late.stats.shaded == late.stats.inside);
+        REQUIRE(late.stats.points == early.stats.points);
+
+        REQUIRE(std::equal(early.getFramebuffer(), early.getFramebuffer() + 64 * 64, late.getFramebuffer()));
+    }
+}
+
+TEST_CASE("late depth test shades the fragments of occluded blocks")
+{
+    // the front triangles cover all blocks, so the hierarchical z
+    // would reject the back one for the early depth test
+    vec3 front1[3]{{0.0f, 0.0f, 0.2f}, {64.0f, 0.0f, 0.2f}, {0.0f, 64.0f, 0.2f}};
+    vec3 front2[3]{{64.0f, 0.0f, 0.2f}, {64.0f, 64.0f, 0.2f}, {0.0f, 64.0f, 0.2f}};
+    vec3 back[3]{{0.0f, 0.0f, 0.6f}, {64.0f, 0.0f, 0.6f}, {0.0f, 64.0f, 0.6f}};
+    for (auto mode : {minity::kScalar, minity::kSimd, minity::kScanline})
+    {
+        for (bool unordered : {false, true})
+        {
+            unsigned long int calls{0};
+            auto countingShader = [&calls](float &u, float &v, float &w, minity::color color) -> minity::color {
+                (void)u; (void)v; (void)w;
+                calls++;
+                return color;
+            };
+
+            minity::rasterizer rasterizer(64, 64);
+            rasterizer.setFillMode(mode);
+            rasterizer.setUnordered(unordered, 2);
+            rasterizer.drawTriangle(front1, minity::green);
+            rasterizer.drawTriangle(front2, minity::green);
+            rasterizer.finishFrame();
+            rasterizer.stats = rasterizerStats{};
+            rasterizer.drawTriangle(back, minity::red, countingShader, minity::kLateDepthTest);
+            rasterizer.finishFrame();
+            REQUIRE(rasterizer.stats.blocksDepthRejected == 0);
+            REQUIRE(calls == rasterizer.stats.inside);
+            REQUIRE(calls == 64 * 65 / 2 - 64); // the pixel centers of the triangle
+            REQUIRE(rasterizer.stats.points == 0);
+            auto fb = rasterizer.getFramebuffer();
+            REQUIRE(std::all_of(fb, fb + 64 * 64, [](minity::color c) { return c == minity::green; }));
+        }
+    }
+}
+
+TEST_CASE("visibility buffer shades every visible pixel once")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    auto triangles = getSphereScene(60, 30, width, height);
+
+    // forward rendering as the reference
+    minity::rasterizer forward(width, height);
+    for (auto &t : triangles)
+        forward.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+    forward.drawPoint(vec3{320.0f, 240.0f, -1.0f}, minity::red);
+
+    for (bool binning : {false, true})
+    {
+        minity::rasterizer deferred(width, height);
+        deferred.setBinning(binning, 4);
+        deferred.setVisibilityBuffer(true);
+        for (u_int32_t id = 0; id < triangles.size(); ++id)
+            deferred.drawTriangle({triangles[id][0], triangles[id][1], triangles[id][2]}, id);
+        deferred.drawPoint(vec3{320.0f, 240.0f, -1.0f}, minity::red);
+        REQUIRE(deferred.getVisibilityBuffer()[0] == minity::kNoTriangle);
+        REQUIRE(deferred.getVisibilityBuffer()[320 + 240 * width] == minity::kNoTriangle); // the point
+        size_t visible = std::count_if(deferred.getVisibilityBuffer(), deferred.getVisibilityBuffer() + width * height,
+            [](u_int32_t id) { return id != minity::kNoTriangle; });
+        REQUIRE(visible > 0);
+
+        std::vector<int> shadedPixels(width * height, 0);
+        deferred.stats.shaded = 0;
+        deferred.shadeVisibilityBuffer([&](int x, int y, u_int32_t id) {
+            shadedPixels[x + y * width]++;
+            minity::edgeFunctions edges{};
+            edges.prepare({triangles[id][0], triangles[id][1], triangles[id][2]});
+            float u, v, w;
+            edges.barycentricAt(x, y, u, v, w);
+            return barycentricShader(u, v, w, minity::yellow);
+        });
+        REQUIRE(deferred.stats.shaded == visible);
+        REQUIRE(std::count(shadedPixels.begin(), shadedPixels.end(), 1) == (long)visible);
+        REQUIRE(std::count_if(shadedPixels.begin(), shadedPixels.end(), [](int n) { return n > 1; }) == 0);
+
+        // same (exact) edge functions in both passes
+        REQUIRE(std::equal(deferred.getFramebuffer(), deferred.getFramebuffer() + width * height, forward.getFramebuffer()));
+        REQUIRE(deferred.getFramebuffer()[320 + 240 * width] == minity::red);
+    }
+}
+
+TEST_CASE("depth prepass shades every covered pixel once")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    auto triangles = getSphereScene(60, 30, width, height);
+
+    for (auto mode : {minity::kScalar, minity::kSimd, minity::kScanline})
+        for (bool binning : {false, true})
+        {
+            minity::rasterizer forward(width, height);
+            forward.setFillMode(mode);
+            forward.setBinning(binning, 4);
+            for (auto &t : triangles)
+                forward.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+            forward.finishFrame();
+
+            minity::rasterizer prepass(width, height);
+            prepass.setFillMode(mode);
+            prepass.setBinning(binning, 4);
+            for (auto &t : triangles)
+                prepass.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader, minity::kDepthOnly);
+            for (auto &t : triangles)
+                prepass.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader, minity::kEqualDepth);
+
+            const float *depth = prepass.getDepthbuffer();
+            const long covered = std::count_if(depth, depth + width * height,
+                [](float z) { return z != std::numeric_limits<float>::infinity(); });
+            REQUIRE(covered > 0);
+            REQUIRE(forward.stats.shaded > (unsigned long int)covered); // overdraw
+            REQUIRE(prepass.stats.shaded == (unsigned long int)covered);
+            REQUIRE(prepass.stats.points == prepass.stats.shaded);
+            REQUIRE(std::equal(depth, depth + width * height, forward.getDepthbuffer()));
+            REQUIRE(std::equal(prepass.getFramebuffer(), prepass.getFramebuffer() + width * height, forward.getFramebuffer()));
+        }
+}
+
+TEST_CASE("tiled layout resolves to the linear image")
+{
+    // not a multiple of the block size, the last blocks are partial
+    const unsigned int width{637};
+    const unsigned int height{477};
+    auto triangles = getSphereScene(60, 30, width, height);
+
+    minity::rasterizer tiled(width, height);
+    tiled.setTiledLayout(true);
+    REQUIRE(tiled.isTiledLayout());
+    REQUIRE(tiled.pixelIndex(0, 0) == 0);
+    REQUIRE(tiled.pixelIndex(7, 0) == 7);
+    REQUIRE(tiled.pixelIndex(0, 1) == 8);
+    REQUIRE(tiled.pixelIndex(8, 0) == 64);
+    REQUIRE(tiled.pixelIndex(0, 8) == 80 * 64);
+
+    auto drawFrame = [&](minity::rasterizer &rasterizer) {
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+        rasterizer.drawLine(vec3{0.0f, 0.0f, -1.0f}, vec3{width - 1.0f, height - 1.0f, -1.0f}, minity::red);
+        rasterizer.drawPoint(vec3{width - 1.0f, height - 1.0f, -1.0f}, minity::green);
+    };
+    minity::rasterizer linear(width, height);
+    drawFrame(linear);
+
+    for (bool binning : {false, true})
+    {
+        tiled.setBinning(binning, 4);
+        tiled.clearBuffers();
+        drawFrame(tiled);
+        REQUIRE(std::equal(tiled.getFramebuffer(), tiled.getFramebuffer() + width * height, linear.getFramebuffer()));
+        REQUIRE(tiled.stats.inside == linear.stats.inside);
+        REQUIRE(std::equal(tiled.getDepthbuffer(), tiled.getDepthbuffer() + width * height, linear.getDepthbuffer()));
+    }
+
+    // switching the layout keeps the contents
+    tiled.setTiledLayout(false);
+    REQUIRE_FALSE(tiled.isTiledLayout());
+    REQUIRE(std::equal(tiled.getFramebuffer(), tiled.getFramebuffer() + width * height, linear.getFramebuffer()));
+    linear.setTiledLayout(true);
+    REQUIRE(std::equal(tiled.getDepthbuffer(), tiled.getDepthbuffer() + width * height, linear.getDepthbuffer()));
+
+    // the visibility buffer is resolved as well
+    linear.setVisibilityBuffer(true);
+    tiled.setVisibilityBuffer(true);
+    linear.clearBuffers();
+    tiled.clearBuffers();
+    for (u_int32_t id = 0; id < triangles.size(); ++id)
+    {
+        linear.drawTriangle({triangles[id][0], triangles[id][1], triangles[id][2]}, id);
+        tiled.drawTriangle({triangles[id][0], triangles[id][1], triangles[id][2]}, id);
+    }
+    REQUIRE(std::equal(tiled.getVisibilityBuffer(), tiled.getVisibilityBuffer() + width * height, linear.getVisibilityBuffer()));
+}
+
+TEST_CASE("fast clear leaves nothing of the previous frame")
+{
+    const unsigned int width{637};
+    const unsigned int height{477};
+    auto triangles = getSphereScene(60, 30, width, height);
+    auto drawSmall = [](minity::rasterizer &rasterizer) {
+        rasterizer.drawTriangle({vec3{10.0f, 10.0f, 0.5f}, vec3{40.0f, 12.0f, 0.5f}, vec3{20.0f, 50.0f, 0.5f}}, minity::red);
+        rasterizer.drawPoint(vec3{636.0f, 476.0f, 0.5f}, minity::green);
+    };
+    minity::rasterizer reference(width, height);
+    drawSmall(reference);
+
+    for (bool tiled : {false, true})
+    {
+        for (bool binning : {false, true})
+        {
+            minity::rasterizer rasterizer(width, height);
+            rasterizer.setTiledLayout(tiled);
+            rasterizer.setBinning(binning, 4);
+            for (auto &t : triangles)
+                rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow);
+            rasterizer.finishFrame();
+
+            rasterizer.clearBuffers();
+            drawSmall(rasterizer);
+            REQUIRE(std::equal(rasterizer.getFramebuffer(), rasterizer.getFramebuffer() + width * height, reference.getFramebuffer()));
+            REQUIRE(std::equal(rasterizer.getDepthbuffer(), rasterizer.getDepthbuffer() + width * height, reference.getDepthbuffer()));
+
+            // nothing drawn at all
+            rasterizer.clearBuffers();
+            REQUIRE(std::count(rasterizer.getFramebuffer(), rasterizer.getFramebuffer() + width * height, minity::black) == width * height);
+
+            // presenting resolved the colors only, the depth is cleared on touch
+            drawSmall(rasterizer);
+            REQUIRE(std::equal(rasterizer.getDepthbuffer(), rasterizer.getDepthbuffer() + width * height, reference.getDepthbuffer()));
+        }
+    }
+}
+
+TEST_CASE("statistics levels only change the counters")
+{
+    const vec3 vertices[3]{vec3{2.0f, 3.0f, 0.5f}, vec3{60.0f, 10.0f, 0.5f}, vec3{20.0f, 61.0f, 0.5f}};
+    const minity::tile viewport{0, 0, 63, 63};
+    minity::rasterizer reference(64, 64);
+    rasterizerStats pixelStats{};
+    minity::plotTriangle<decltype(barycentricShader), kPixelStats>(vertices, minity::yellow, &reference, barycentricShader, minity::kEarlyDepthTest, viewport, pixelStats);
+    REQUIRE(pixelStats.inside > 0);
+    REQUIRE(pixelStats.blocksPartial > 0);
+
+    for (auto mode : {minity::kScalar, minity::kSimd})
+    {
+        minity::rasterizer rasterizer(64, 64);
+        rasterizer.setFillMode(mode);
+        rasterizerStats frameStats{};
+        minity::plotTriangle<decltype(barycentricShader), kFrameStats>(vertices, minity::yellow, &rasterizer, barycentricShader, minity::kEarlyDepthTest, viewport, frameStats);
+        REQUIRE(frameStats.blocksPartial == pixelStats.blocksPartial);
+        REQUIRE(frameStats.blocksAccepted == pixelStats.blocksAccepted);
+        REQUIRE(frameStats.inside == 0);
+        REQUIRE(frameStats.points == 0);
+
+        // drawn again over itself: hierarchical z still works without counters
+        rasterizerStats noStats{};
+        minity::plotTriangle<decltype(barycentricShader), kNoStats>(vertices, minity::yellow, &rasterizer, barycentricShader, minity::kEarlyDepthTest, viewport, noStats);
+        REQUIRE(noStats.blocksPartial == 0);
+        REQUIRE(noStats.blocksAccepted == 0);
+        REQUIRE(std::equal(rasterizer.getFramebuffer(), rasterizer.getFramebuffer() + 64 * 64, reference.getFramebuffer()));
+        REQUIRE(std::equal(rasterizer.getDepthbuffer(), rasterizer.getDepthbuffer() + 64 * 64, reference.getDepthbuffer()));
+    }
+}
+
+TEST_CASE("depth formats draw the same sphere")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    auto triangles = getSphereScene(60, 30, width, height);
+    auto reversedTriangles = getSphereScene(60, 30, width, height, true);
+
+    minity::rasterizer reference(width, height);
+    for (auto &t : triangles)
+        reference.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+
+    for (auto format : {minity::kDepthReversedFloat, minity::kDepthUnorm24, minity::kDepthUnorm16})
+    {
+        for (auto mode : {minity::kScalar, minity::kSimd})
+        {
+            minity::rasterizer rasterizer(width, height);
+            rasterizer.setDepthFormat(format);
+            rasterizer.setFillMode(mode);
+            REQUIRE(rasterizer.getDepthFormat() == format);
+            for (auto &t : format == minity::kDepthReversedFloat ? reversedTriangles : triangles)
+                rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+
+            REQUIRE(std::equal(rasterizer.getFramebuffer(), rasterizer.getFramebuffer() + width * height, reference.getFramebuffer()));
+            REQUIRE(rasterizer.stats.blocksDepthRejected == reference.stats.blocksDepthRejected);
+
+            // unorm depths are decoded to z within half a step, 24 bit are at
+            // the limit of the float math of encode and decode though
+            if (format == minity::kDepthReversedFloat)
+                continue;
+            const float tolerance = format == minity::kDepthUnorm24 ? 4.0f * 2.0f / 0xffffff : 2.0f / 0xffff;
+            const float *depth = rasterizer.getDepthbuffer();
+            const float *referenceDepth = reference.getDepthbuffer();
+            size_t wrong{0};
+            for (unsigned int i = 0; i < width * height; ++i)
+                if (std::isfinite(referenceDepth[i]) ? std::fabs(depth[i] - referenceDepth[i]) > tolerance : depth[i] != 1.0f)
+                    wrong++;
+            REQUIRE(wrong == 0);
+        }
+    }
+}
+
+// pixels of the far plane drawn over the near plane (z-fighting) with
+// two planes at distance and distance + separation in front of the camera
+size_t zFightingPixels(minity::depthFormat format, float distance, float separation)
+{
+    const unsigned int size{32};
+    mat4 projectionMatrix = perspectiveProjectionMatrix(50.0f, 1.0f, 0.1f, 400.0f, format == minity::kDepthReversedFloat);
+    auto planeZ = [&](float z) {
+        vec3 clip = multiplyVec3(vec3{0.0f, 0.0f, -z}, projectionMatrix);
+        return clip.z / clip.w;
+    };
+    minity::rasterizer rasterizer(size, size);
+    rasterizer.setDepthFormat(format);
+    for (auto plane : {std::make_pair(distance, minity::green), std::make_pair(distance + separation, minity::red)})
+    {
+        const float z = planeZ(plane.first);
+        rasterizer.drawTriangle({vec3{0.0f, 0.0f, z}, vec3{(float)size, 0.0f, z}, vec3{0.0f, (float)size, z}}, plane.second);
+        rasterizer.drawTriangle({vec3{(float)size, 0.0f, z}, vec3{(float)size, (float)size, z}, vec3{0.0f, (float)size, z}}, plane.second);
+    }
+    return std::count(rasterizer.getFramebuffer(), rasterizer.getFramebuffer() + size * size, minity::red);
+}
+
+TEST_CASE("depth precision of the formats at several depths")
+{
+    // the near plane is 0.1 and the far plane 400 like in the software engine
+    for (float distance : {1.0f, 10.0f, 50.0f, 100.0f, 200.0f, 350.0f})
+    {
+        REQUIRE(zFightingPixels(minity::kDepthReversedFloat, distance, distance * 1e-4f) == 0);
+        REQUIRE(zFightingPixels(minity::kDepthFloat, distance, distance * 1e-3f) == 0);
+        REQUIRE(zFightingPixels(minity::kDepthUnorm24, distance, distance * 1e-3f) == 0);
+    }
+    REQUIRE(zFightingPixels(minity::kDepthFloat, 350.0f, 0.035f) > 0);
+    REQUIRE(zFightingPixels(minity::kDepthUnorm24, 350.0f, 0.035f) > 0);
+
+    // 16 bit are only good for the first units in front of the camera
+    REQUIRE(zFightingPixels(minity::kDepthUnorm16, 1.0f, 0.01f) == 0);
+    REQUIRE(zFightingPixels(minity::kDepthUnorm16, 10.0f, 0.1f) == 0);
+    REQUIRE(zFightingPixels(minity::kDepthUnorm16, 100.0f, 1.0f) > 0);
+}
+
+//
+// Benchmarks (hidden, run with: filter="[benchmark]" make test)
+//
+
+// the per pixel barycentric loop that plotTriangle used before
+// the edge functions, kept here as the baseline for benchmarks
+void plotTriangleBarycentric(const vec3 (&vertices)[3], const minity::color rgba_color, minity::rasterizer *rasterizer, minity::lambdaShader fragmentShader)
+{
+    int maxX = std::max(vertices[0].x, std::max(vertices[1].x, vertices[2].x));
+    int minX = std::min(vertices[0].x, std::min(vertices[1].x, vertices[2].x));
+    int maxY = std::max(vertices[0].y, std::max(vertices[1].y, vertices[2].y));
+    int minY = std::min(vertices[0].y, std::min(vertices[1].y, vertices[2].y));
+    float u{0};
+    float v{0};
+    float w{0};
+    minity::barycentricCoordinates bc{};
+    bc.prepare(vertices);
+    for (int x = minX; x <= maxX; x++)
+    {
+        for (int y = minY; y <= maxY; y++)
+        {
+            vec3 point = {static_cast<float>(x) + 0.5f, static_cast<float>(y) + 0.5f, 0};
+            bc.barycentricCoordinatesAt(vertices, point, u, v, w);
+            if (!std::isfinite(u) || !std::isfinite(v) || !std::isfinite(w))
+                continue;
+            if (u < 0 || v < 0 || w < 0)
+                continue;
+            rasterizer->stats.inside++;
+            float z = vertices[0].z * u + vertices[1].z * v + vertices[2].z * w;
+            rasterizer->drawPoint(vec3{(float)x, (float)y, z}, fragmentShader(u, v, w, rgba_color));
+        }
+    }
+}
+
+// run drawFrame until at least a second has passed and
+// print the covered pixels per second
+template <typename F>
+void benchmarkFillRate(const std::string &name, minity::rasterizer &rasterizer, F drawFrame)
+{
+    using clock = std::chrono::steady_clock;
+    unsigned long int pixels{0};
+    int frames{0};
+    auto start = clock::now();
+    std::chrono::duration<double> elapsed{0};
+    while (elapsed.count() < 1.0)
+    {
+        rasterizer.clearBuffers();
+        drawFrame();
+        pixels += rasterizer.stats.inside;
+        frames++;
+        elapsed = clock::now() - start;
+    }
+    std::cout << name << ": " << frames / elapsed.count() << " frames/s, "
+        << pixels / elapsed.count() / 1.0e6 << " Mpixels/s" << std::endl;
+}
+
+TEST_CASE("benchmark - edge functions vs barycentric on 60x30 sphere", "[.benchmark]")
+{
+    const unsigned int width{640};
+    const unsigned int height{480};
+    auto triangles = getSphereScene(60, 30, width, height);
+    minity::rasterizer rasterizer(width, height);
+    rasterizer.setFillMode(minity::kScalar);
+
+    benchmarkFillRate("barycentric (before)", rasterizer, [&]() {
+        for (auto &t : triangles)
+            plotTriangleBarycentric({t[0], t[1], t[2]}, minity::yellow, &rasterizer, minity::nullShader);
+    });
+    benchmarkFillRate("edge functions", rasterizer, [&]() {
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow);
+    });
+}
+
+TEST_CASE("benchmark - binned rendering thread scaling on 60x30 sphere", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    auto triangles = getSphereScene(60, 30, width, height);
+    minity::rasterizer rasterizer(width, height);
+
+    auto drawFrame = [&]() {
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+        rasterizer.finishFrame();
+    };
+    benchmarkFillRate("immediate", rasterizer, drawFrame);
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads : {1u, 2u, 4u, 8u, cores})
+    {
+        rasterizer.setBinning(true, threads);
+        benchmarkFillRate("binned " + std::to_string(threads) + " threads", rasterizer, drawFrame);
+    }
+}
+
+TEST_CASE("benchmark - scalar vs simd fill on large triangles", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    minity::rasterizer rasterizer(width, height);
+
+    // full screen quads stacked in depth, drawn in both orders:
+    // front-to-back most pixels fail the depth test (early z pays off),
+    // back-to-front every pixel is shaded and written
+    std::vector<std::array<vec3, 3>> layers{};
+    for (int i = 0; i < 8; ++i)
+    {
+        float z = 0.1f * i;
+        layers.push_back({vec3{0.0f, 0.0f, z}, vec3{(float)width, 0.0f, z}, vec3{0.0f, (float)height, z}});
+        layers.push_back({vec3{(float)width, 0.0f, z}, vec3{(float)width, (float)height, z}, vec3{0.0f, (float)height, z}});
+    }
+
+    for (auto mode : {minity::kScalar, minity::kSimd})
+    {
+        rasterizer.setFillMode(mode);
+        std::string name = mode == minity::kSimd ? "simd" : "scalar";
+        benchmarkFillRate(name + " front-to-back", rasterizer, [&]() {
+            for (auto &t : layers)
+                rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+        });
+        benchmarkFillRate(name + " back-to-front", rasterizer, [&]() {
+            for (auto it = layers.rbegin(); it != layers.rend(); ++it)
+                rasterizer.drawTriangle({(*it)[0], (*it)[1], (*it)[2]}, minity::yellow, barycentricShader);
+        });
+    }
+}
+
+TEST_CASE("benchmark - std::function vs inlined textured shader on 60x30 sphere", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    auto triangles = getSphereScene(60, 30, width, height);
+    minity::rasterizer rasterizer(width, height);
+
+    // 256x256 checkerboard texture, perspective correct lookup like in the software engine
+    const int textureSize{256};
+    std::vector<minity::color> texels(textureSize * textureSize);
+    for (int i = 0; i < textureSize * textureSize; ++i)
+        texels[i] = ((i / 16) % 2) ^ ((i / (16 * textureSize)) % 2) ? minity::white : minity::blue;
+    struct textureShader
+    {
+        const minity::color *texels;
+        vec2 texc[3];
+        float clipW[3];
+        minity::color operator()(float &u, float &v, float &w, minity::color color) const
+        {
+            (void)color;
+            float denominator = u / clipW[0] + v / clipW[1] + w / clipW[2];
+            float uu = (u * texc[0].u / clipW[0] + v * texc[1].u / clipW[1] + w * texc[2].u / clipW[2]) / denominator;
+            float vv = (u * texc[0].v / clipW[0] + v * texc[1].v / clipW[1] + w * texc[2].v / clipW[2]) / denominator;
+            int x = std::min(static_cast<int>(uu * textureSize), textureSize - 1);
+            int y = std::min(static_cast<int>(vv * textureSize), textureSize - 1);
+            return texels[x + y * textureSize];
+        }
+    };
+    std::vector<textureShader> shaders{};
+    for (auto &t : triangles)
+    {
+        textureShader shader{texels.data(), {}, {}};
+        for (int i : {0, 1, 2})
+        {
+            shader.texc[i] = vec2{t[i].x / width, t[i].y / height};
+            shader.clipW[i] = 1.0f + t[i].z;
+        }
+        shaders.push_back(shader);
+    }
+
+    // the same lookup with the texture coordinates set up once per triangle
+    struct varyingsShader
+    {
+        const minity::color *texels;
+        minity::varyings<2> texc;
+        minity::color operator()(float &u, float &v, float &w, minity::color color) const
+        {
+            (void)color;
+            float uv[2];
+            texc.at(u, v, w, uv);
+            int x = std::min(static_cast<int>(uv[0] * textureSize), textureSize - 1);
+            int y = std::min(static_cast<int>(uv[1] * textureSize), textureSize - 1);
+            return texels[x + y * textureSize];
+        }
+    };
+    std::vector<varyingsShader> setupShaders{};
+    for (auto &shader : shaders)
+    {
+        varyingsShader setup{texels.data(), {}};
+        const float texc[3][2]{{shader.texc[0].u, shader.texc[0].v}, {shader.texc[1].u, shader.texc[1].v}, {shader.texc[2].u, shader.texc[2].v}};
+        setup.texc.prepare(texc, shader.clipW);
+        setupShaders.push_back(setup);
+    }
+
+    for (auto mode : {minity::kScalar, minity::kSimd})
+    {
+        rasterizer.setFillMode(mode);
+        std::string name = mode == minity::kSimd ? "simd" : "scalar";
+        benchmarkFillRate(name + " varyings (per triangle setup)", rasterizer, [&]() {
+            for (size_t i = 0; i < triangles.size(); ++i)
+                rasterizer.drawTriangle({triangles[i][0], triangles[i][1], triangles[i][2]}, minity::yellow, setupShaders[i]);
+        });
+        benchmarkFillRate(name + " lambdaShader (before)", rasterizer, [&]() {
+            for (size_t i = 0; i < triangles.size(); ++i)
+                rasterizer.drawTriangle({triangles[i][0], triangles[i][1], triangles[i][2]}, minity::yellow, minity::lambdaShader(shaders[i]));
+        });
+        benchmarkFillRate(name + " inlined shader", rasterizer, [&]() {
+            for (size_t i = 0; i < triangles.size(); ++i)
+                rasterizer.drawTriangle({triangles[i][0], triangles[i][1], triangles[i][2]}, minity::yellow, shaders[i]);
+        });
+    }
+}
+
+TEST_CASE("benchmark - linear vs tiled buffer layout on 60x30 sphere", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    auto triangles = getSphereScene(60, 30, width, height);
+
+    // cache lines (64 bytes, 16 pixels) holding the pixels of each triangle
+    minity::rasterizer ids(width, height);
+    ids.setVisibilityBuffer(true);
+    for (u_int32_t id = 0; id < triangles.size(); ++id)
+        ids.drawTriangle({triangles[id][0], triangles[id][1], triangles[id][2]}, id);
+    for (bool tiled : {false, true})
+    {
+        ids.setTiledLayout(tiled);
+        const u_int32_t *visible = ids.getVisibilityBuffer();
+        std::vector<std::pair<u_int32_t, size_t>> lines{};
+        for (unsigned int y = 0; y < height; ++y)
+            for (unsigned int x = 0; x < width; ++x)
+                if (visible[x + y * width] != minity::kNoTriangle)
+                    lines.push_back({visible[x + y * width], ids.pixelIndex(x, y) / 16});
+        std::sort(lines.begin(), lines.end());
+        size_t touched = std::unique(lines.begin(), lines.end()) - lines.begin();
+        std::cout << (tiled ? "tiled" : "linear") << ": " << (double)touched / triangles.size()
+            << " cache lines per triangle, " << (double)lines.size() / touched << " visible pixels per line" << std::endl;
+    }
+
+    minity::rasterizer rasterizer(width, height);
+    for (bool tiled : {false, true})
+    {
+        rasterizer.setTiledLayout(tiled);
+        std::string name = tiled ? "tiled" : "linear";
+        // the resolve before handing the image to SDL is part of the frame
+        benchmarkFillRate(name, rasterizer, [&]() {
+            for (auto &t : triangles)
+                rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+            rasterizer.getFramebuffer();
+        });
+    }
+}
+
+TEST_CASE("benchmark - full vs fast clear at 3840x2160", "[.benchmark]")
+{
+    const unsigned int width{3840};
+    const unsigned int height{2160};
+    auto triangles = getSphereScene(60, 30, width / 4, height / 4); // a small model
+    minity::rasterizer rasterizer(width, height);
+
+    // the std::fill of both buffers that clearBuffers did before
+    std::vector<minity::color> colors(width * height);
+    std::vector<float> depths(width * height);
+    benchmarkFillRate("full clear (before)", rasterizer, [&]() {
+        std::fill(colors.begin(), colors.end(), minity::black);
+        std::fill(depths.begin(), depths.end(), std::numeric_limits<float>::infinity());
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow);
+    });
+    for (bool tiled : {false, true})
+    {
+        rasterizer.setTiledLayout(tiled);
+        // including the resolve of the untouched blocks for presenting
+        benchmarkFillRate(tiled ? "tiled fast clear" : "linear fast clear", rasterizer, [&]() {
+            for (auto &t : triangles)
+                rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow);
+            rasterizer.getFramebuffer();
+        });
+    }
+}
+
+TEST_CASE("benchmark - statistics levels on 60x30 sphere", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    auto triangles = getSphereScene(60, 30, width, height);
+    minity::rasterizer rasterizer(width, height);
+    const minity::tile viewport{0, 0, (int)width - 1, (int)height - 1};
+
+    // plotTriangle directly, the rasterizer itself uses MINITY_RASTERIZER_STATS
+    unsigned long int covered{0};
+    auto drawFrame = [&](auto level) {
+        rasterizerStats frameStats{};
+        for (auto &t : triangles)
+            minity::plotTriangle<decltype(barycentricShader), decltype(level)::value>({t[0], t[1], t[2]}, minity::yellow,
+                &rasterizer, barycentricShader, minity::kEarlyDepthTest, viewport, frameStats);
+        if (frameStats.inside > 0)
+            covered = frameStats.inside;
+        rasterizer.stats.inside += covered; // the counter may be compiled out
+    };
+    for (auto mode : {minity::kScalar, minity::kSimd})
+    {
+        rasterizer.setFillMode(mode);
+        std::string name = mode == minity::kSimd ? "simd" : "scalar";
+        benchmarkFillRate(name + " pixel stats", rasterizer, [&]() { drawFrame(std::integral_constant<statsLevel, kPixelStats>{}); });
+        benchmarkFillRate(name + " frame stats", rasterizer, [&]() { drawFrame(std::integral_constant<statsLevel, kFrameStats>{}); });
+        benchmarkFillRate(name + " no stats", rasterizer, [&]() { drawFrame(std::integral_constant<statsLevel, kNoStats>{}); });
+    }
+}
+
+TEST_CASE("benchmark - depth formats on large triangles", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    minity::rasterizer rasterizer(width, height);
+
+    for (auto format : {minity::kDepthFloat, minity::kDepthReversedFloat, minity::kDepthUnorm24, minity::kDepthUnorm16})
+    {
+        // full screen quads stacked in depth like the scalar vs simd benchmark
+        std::vector<std::array<vec3, 3>> layers{};
+        for (int i = 0; i < 8; ++i)
+        {
+            float z = format == minity::kDepthReversedFloat ? 1.0f - 0.1f * i : 0.1f * i;
+            layers.push_back({vec3{0.0f, 0.0f, z}, vec3{(float)width, 0.0f, z}, vec3{0.0f, (float)height, z}});
+            layers.push_back({vec3{(float)width, 0.0f, z}, vec3{(float)width, (float)height, z}, vec3{0.0f, (float)height, z}});
+        }
+
+        rasterizer.setDepthFormat(format);
+        const std::string names[]{"float", "reversed float", "unorm24", "unorm16"};
+        benchmarkFillRate(names[format] + " front-to-back", rasterizer, [&]() {
+            for (auto &t : layers)
+                rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow);
+        });
+        benchmarkFillRate(names[format] + " back-to-front", rasterizer, [&]() {
+            for (auto it = layers.rbegin(); it != layers.rend(); ++it)
+                rasterizer.drawTriangle({(*it)[0], (*it)[1], (*it)[2]}, minity::yellow);
+        });
+    }
+}
+
+TEST_CASE("benchmark - wireframe of the 60x30 sphere", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    auto triangles = getSphereScene(60, 30, width, height);
+    std::vector<std::array<vec3, 2>> lines{};
+    for (auto &t : triangles)
+        for (int i : {0, 1, 2})
+            lines.push_back({t[i], t[(i + 1) % 3]});
+    minity::rasterizer rasterizer(width, height);
+
+    auto benchmark = [&](const std::string &name, auto drawFrame) {
+        using clock = std::chrono::steady_clock;
+        unsigned long int pixels{0};
+        int frames{0};
+        auto start = clock::now();
+        std::chrono::duration<double> elapsed{0};
+        while (elapsed.count() < 1.0)
+        {
+            rasterizer.clearBuffers();
+            rasterizer.stats = {};
+            drawFrame();
+            pixels += rasterizer.stats.points + rasterizer.stats.depth;
+            frames++;
+            elapsed = clock::now() - start;
+        }
+        std::cout << name << ": " << frames / elapsed.count() << " frames/s, "
+            << pixels / elapsed.count() / 1.0e6 << " Mpixels/s" << std::endl;
+    };
+    benchmark("drawLine", [&]() {
+        for (auto &line : lines)
+            rasterizer.drawLine(line[0], line[1], minity::gray50);
+    });
+    benchmark("drawLines", [&]() { rasterizer.drawLines(lines.data(), lines.size(), minity::gray50); });
+}
+
+TEST_CASE("benchmark - block vs scanline fill", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    minity::rasterizer rasterizer(width, height);
+
+    auto sphere = getSphereScene(60, 30, width, height);
+    std::vector<std::array<vec3, 3>> layers{};
+    for (int i = 0; i < 8; ++i)
+    {
+        float z = 0.1f * i;
+        layers.push_back({vec3{0.0f, 0.0f, z}, vec3{(float)width, 0.0f, z}, vec3{0.0f, (float)height, z}});
+        layers.push_back({vec3{(float)width, 0.0f, z}, vec3{(float)width, (float)height, z}, vec3{0.0f, (float)height, z}});
+    }
+    // thin diagonal slivers, a few pixels wide with screen sized bounding boxes
+    std::vector<std::array<vec3, 3>> slivers{};
+    for (int i = 0; i < 200; ++i)
+    {
+        float offset = i * 9.0f;
+        slivers.push_back({vec3{offset, 0.0f, 0.5f}, vec3{offset + 4.0f, 0.0f, 0.5f}, vec3{offset + 200.0f, (float)height - 1.0f, 0.5f}});
+    }
+
+    auto draw = [&](const std::vector<std::array<vec3, 3>> &triangles) {
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+    };
+    for (auto mode : {minity::kScalar, minity::kSimd, minity::kScanline})
+    {
+        rasterizer.setFillMode(mode);
+        const std::string names[]{"scalar", "simd", "scanline"};
+        benchmarkFillRate(names[mode] + " sphere", rasterizer, [&]() { draw(sphere); });
+        benchmarkFillRate(names[mode] + " large front-to-back", rasterizer, [&]() { draw(layers); });
+        benchmarkFillRate(names[mode] + " large back-to-front", rasterizer, [&]() {
+            draw(std::vector<std::array<vec3, 3>>(layers.rbegin(), layers.rend()));
+        });
+        benchmarkFillRate(names[mode] + " slivers", rasterizer, [&]() { draw(slivers); });
+    }
+}
+
+TEST_CASE("benchmark - per fragment divides vs varyings setup", "[.benchmark]")
+{
+    // texture u, v and the normal of the textured and lit shader, 1024 faces
+    // of 64 fragments each (in a 1920x1080 frame) like in the software engine
+    struct face
+    {
+        vec2 texc[3];
+        vec3 normals[3];
+        float clipW[3];
+    };
+    std::vector<face> faces{};
+    std::vector<minity::varyings<5>> setups{};
+    for (int i = 0; i < 1024; ++i)
+    {
+        const float a = i * 0.001f;
+        face f{{{a, 0.0f}, {1.0f, a}, {0.0f, 1.0f - a}}, {{a, 0.0f, 1.0f}, {0.0f, 1.0f, a}, {1.0f, a, 0.0f}}, {1.0f + a, 3.0f - a, 7.0f * a + 1.0f}};
+        float values[3][5];
+        for (int vertex : {0, 1, 2})
+        {
+            values[vertex][0] = f.texc[vertex].u;
+            values[vertex][1] = f.texc[vertex].v;
+            values[vertex][2] = f.normals[vertex].x;
+            values[vertex][3] = f.normals[vertex].y;
+            values[vertex][4] = f.normals[vertex].z;
+        }
+        minity::varyings<5> setup{};
+        setup.prepare(values, f.clipW);
+        faces.push_back(f);
+        setups.push_back(setup);
+    }
+
+    const int fragments{1920 * 1080};
+    std::vector<std::array<float, 3>> barycentric(fragments);
+    for (int i = 0; i < fragments; ++i)
+    {
+        float u = (i % 1000) * 0.001f;
+        float v = (1.0f - u) * ((i % 997) * 0.001f);
+        barycentric[i] = {u, v, 1.0f - u - v};
+    }
+    std::vector<float> out(fragments);
+
+    auto benchmark = [&](const std::string &name, auto fragment) {
+        using clock = std::chrono::steady_clock;
+        auto start = clock::now();
+        for (int i = 0; i < fragments; ++i)
+            out[i] = fragment(i / 64 % 1024, barycentric[i][0], barycentric[i][1], barycentric[i][2]);
+        std::chrono::duration<double> elapsed = clock::now() - start;
+        std::cout << name << ": " << fragments / elapsed.count() / 1.0e6 << " Mfragments/s" << std::endl;
+    };
+    for (int run = 0; run < 2; ++run)
+    {
+        benchmark("per fragment (before)", [&](int i, float u, float v, float w) {
+            const vec2 (&texc)[3] = faces[i].texc;
+            const vec3 (&normals)[3] = faces[i].normals;
+            const float (&clipW)[3] = faces[i].clipW;
+            float denominator = u / clipW[0] + v / clipW[1] + w / clipW[2];
+            float uu = (u * texc[0].u / clipW[0] + v * texc[1].u / clipW[1] + w * texc[2].u / clipW[2]) / denominator;
+            float vv = (u * texc[0].v / clipW[0] + v * texc[1].v / clipW[1] + w * texc[2].v / clipW[2]) / denominator;
+            vec3 n = v3Normalize(vec3{
+                normals[0].x * u + normals[1].x * v + normals[2].x * w,
+                normals[0].y * u + normals[1].y * v + normals[2].y * w,
+                normals[0].z * u + normals[1].z * v + normals[2].z * w});
+            return uu + vv + n.x;
+        });
+        benchmark("varyings", [&](int i, float u, float v, float w) {
+            const minity::varyings<5> &setup = setups[i];
+            const float correction = setup.perspective(u, v, w);
+            vec3 n = v3Normalize(vec3{setup.overWAt(2, u, v, w), setup.overWAt(3, u, v, w), setup.overWAt(4, u, v, w)});
+            return setup.overWAt(0, u, v, w) * correction + setup.overWAt(1, u, v, w) * correction + n.x;
+        });
+        benchmark("varyings (all corrected)", [&](int i, float u, float v, float w) {
+            float at[5];
+            setups[i].at(u, v, w, at);
+            vec3 n = v3Normalize(vec3{at[2], at[3], at[4]});
+            return at[0] + at[1] + n.x;
+        });
+    }
+}
+
+TEST_CASE("benchmark - small triangle fast paths on a 512x256 sphere", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    // the software engine culls the back faces before rasterizing
+    std::vector<std::array<vec3, 3>> triangles{};
+    for (auto &t : getSphereScene(512, 256, width, height))
+        if ((t[1].x - t[0].x) * (t[2].y - t[0].y) - (t[2].x - t[0].x) * (t[1].y - t[0].y) < 0.0f)
+            triangles.push_back(t);
+    minity::rasterizer rasterizer(width, height);
+
+    benchmarkFillRate("block walk (before)", rasterizer, [&]() {
+        for (auto &t : triangles)
+            fillWithBlocks({t[0], t[1], t[2]}, rasterizer, barycentricShader);
+    });
+    benchmarkFillRate("fast paths", rasterizer, [&]() {
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+    });
+    rasterizer.stats = {};
+    rasterizer.clearBuffers();
+    for (auto &t : triangles)
+        rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+    std::cout << triangles.size() << " triangles: " << rasterizer.stats.culled << " culled, " << rasterizer.stats.tiny
+        << " tiny, " << rasterizer.stats.small << " small" << std::endl;
+}
+
+TEST_CASE("benchmark - forward shading vs depth prepass", "[.benchmark]")
+{
+    // the diffuse lighting of the software engine, the depth complexity of
+    // the back-to-front layers is the overdraw
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    minity::rasterizer rasterizer(width, height);
+    auto sphere = getSphereScene(60, 30, width, height);
+    std::vector<std::array<vec3, 3>> layers{};
+    for (int i = 7; i >= 0; --i)
+    {
+        float z = 0.1f * i;
+        layers.push_back({vec3{0.0f, 0.0f, z}, vec3{(float)width, 0.0f, z}, vec3{0.0f, (float)height, z}});
+        layers.push_back({vec3{(float)width, 0.0f, z}, vec3{(float)width, (float)height, z}, vec3{0.0f, (float)height, z}});
+    }
+
+    auto litShader = [](float &u, float &v, float &w, minity::color color) -> minity::color {
+        const float dp = std::max(0.1f, (u * 0.3f + v * 0.5f + w * 0.8f) / std::sqrt(u * u + v * v + w * w));
+        minity::color lit{color & 0xff}; // alpha
+        for (int shift : {8, 16, 24})
+            lit |= static_cast<minity::color>(((color >> shift) & 0xff) * dp) << shift;
+        return lit;
+    };
+    auto draw = [&](const std::vector<std::array<vec3, 3>> &triangles, bool prepass) {
+        if (prepass)
+            for (auto &t : triangles)
+                rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, minity::nullShader, minity::kDepthOnly);
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, litShader,
+                prepass ? minity::kEqualDepth : minity::kEarlyDepthTest);
+    };
+    for (bool prepass : {false, true})
+    {
+        const std::string name = prepass ? "depth prepass" : "forward";
+        benchmarkFillRate(name + " sphere", rasterizer, [&]() { draw(sphere, prepass); });
+        std::cout << "    shaded: " << rasterizer.stats.shaded << std::endl;
+        benchmarkFillRate(name + " 8 layers back-to-front", rasterizer, [&]() { draw(layers, prepass); });
+        std::cout << "    shaded: " << rasterizer.stats.shaded << std::endl;
+    }
+}
+
+TEST_CASE("benchmark - binned vs sort-last rendering of a 512x256 sphere", "[.benchmark]")
+{
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    auto triangles = getSphereScene(512, 256, width, height);
+    minity::rasterizer rasterizer(width, height);
+
+    auto drawFrame = [&]() {
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+        rasterizer.finishFrame();
+    };
+    benchmarkFillRate("immediate", rasterizer, drawFrame);
+
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads : {1u, 2u, 4u, cores})
+    {
+        rasterizer.setBinning(true, threads);
+        benchmarkFillRate("binned " + std::to_string(threads) + " threads", rasterizer, drawFrame);
+        rasterizer.setSortLast(true, threads);
+        benchmarkFillRate("sort-last " + std::to_string(threads) + " threads", rasterizer, drawFrame);
+    }
+}
+
+TEST_CASE("benchmark - binned vs unordered rendering contention", "[.benchmark]")
+{
+    // the sphere spreads the pixels, the 8 screen sized layers all
+    // threads write to the same pixels
+    const unsigned int width{1920};
+    const unsigned int height{1080};
+    auto sphere = getSphereScene(60, 30, width, height);
+    std::vector<std::array<vec3, 3>> layers{};
+    for (int i = 0; i < 8; ++i)
+    {
+        float z = 0.1f * i;
+        layers.push_back({vec3{0.0f, 0.0f, z}, vec3{(float)width, 0.0f, z}, vec3{0.0f, (float)height, z}});
+        layers.push_back({vec3{(float)width, 0.0f, z}, vec3{(float)width, (float)height, z}, vec3{0.0f, (float)height, z}});
+    }
+    minity::rasterizer rasterizer(width, height);
+    rasterizer.setFillMode(minity::kScanline);
+
+    auto draw = [&](const std::vector<std::array<vec3, 3>> &triangles) {
+        for (auto &t : triangles)
+            rasterizer.drawTriangle({t[0], t[1], t[2]}, minity::yellow, barycentricShader);
+        rasterizer.finishFrame();
+    };
+    unsigned int cores = std::max(1u, std::thread::hardware_concurrency());
+    for (unsigned int threads : {1u, 2u, 4u, cores})
+    {
+        const std::string suffix = " " + std::to_string(threads) + " threads";
+        rasterizer.setBinning(true, threads);
+        benchmarkFillRate("binned sphere" + suffix, rasterizer, [&]() { draw(sphere); });
+        benchmarkFillRate("binned layers" + suffix, rasterizer, [&]() { draw(layers); });
+        rasterizer.setUnordered(true, threads);
+        benchmarkFillRate("unordered sphere" + suffix, rasterizer, [&]() { draw(sphere); });
+        benchmarkFillRate("unordered layers" + suffix, rasterizer, [&]() { draw(layers); });
+    }
+}